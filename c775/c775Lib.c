@@ -15,8 +15,11 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <pthread.h>
+#include <time.h>
 #ifdef VXWORKS
 #include "vxWorks.h"
 #include "logLib.h"
@@ -24,9 +27,19 @@
 #include "intLib.h"
 #include "iv.h"
 #include "semLib.h"
+#include "memLib.h"
 #include "vxLib.h"
+#include "sysLib.h"
+#include "tickLib.h"
+#else
+#include <unistd.h>
+#include <sys/eventfd.h>
 #endif
 #include "jvme.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define C775_X86_SIMD
+#include <immintrin.h>
+#endif
 
 /* Include TDC definitions */
 #include "c775Lib.h"
@@ -39,78 +52,664 @@ IMPORT STATUS sysIntEnable(int);
 IMPORT STATUS sysIntDisable(int);
 #endif
 
-/* Mutex to guard c775 reads/writes */
-pthread_mutex_t c775mutex = PTHREAD_MUTEX_INITIALIZER;
-#define C775LOCK   if(pthread_mutex_lock(&c775mutex)<0) perror("pthread_mutex_lock");
-#define C775UNLOCK if(pthread_mutex_unlock(&c775mutex)<0) perror("pthread_mutex_unlock");
+/* VME cycles made by the calling thread: every D16/D32 single cycle and
+   every DMA counts one (c775GetBusCycles) */
+#ifdef VXWORKS
+LOCAL unsigned int c775BusCycles = 0;
+#else
+LOCAL __thread unsigned int c775BusCycles = 0;
+#endif
+#define vmeRead16(a)     (c775BusCycles++, vmeRead16(a))
+#define vmeRead32(a)     (c775BusCycles++, vmeRead32(a))
+#define vmeWrite16(a,v)  (c775BusCycles++, vmeWrite16(a,v))
+#define vmeWrite32(a,v)  (c775BusCycles++, vmeWrite32(a,v))
+
+/* Per TDC state.  Each TDC gets its own cache line, so readout threads
+   working on different TDCs neither share a lock nor false-share the
+   counters.  A TDC owned by a single thread can skip locking entirely
+   (c775SetSingleOwner). */
+#define C775_CACHE_LINE 64
+typedef struct
+{
+  pthread_mutex_t mutex;	/* Guards this TDC's registers and counters */
+  int singleOwner;		/* No locking: one thread owns this TDC */
+  int eventCount;		/* Count of Events taken by TDC (Event Count Register value) */
+  int evtReadCnt;		/* Count of events read from specified TDC */
+  int evReady;			/* Event Count when data was last seen ready */
+  int d32Count;			/* Event Counter readable with one D32 cycle */
+} __attribute__ ((aligned (C775_CACHE_LINE))) c775_state;
+
+/* Mutex to guard c775 reads/writes, per TDC */
+#define C775LOCK(id)   if(!ctx->state[id].singleOwner && (pthread_mutex_lock(&ctx->state[id].mutex)<0)) perror("pthread_mutex_lock");
+#define C775UNLOCK(id) if(!ctx->state[id].singleOwner && (pthread_mutex_unlock(&ctx->state[id].mutex)<0)) perror("pthread_mutex_unlock");
+/* Crate wide operations lock every TDC, always in id order */
+#define C775LOCK_ALL   c775LockAll(ctx);
+#define C775UNLOCK_ALL c775UnlockAll(ctx);
+
+/* DMA engine ownership and asynchronous block read state */
+LOCAL pthread_mutex_t c775DmaMutex = PTHREAD_MUTEX_INITIALIZER;
+LOCAL pthread_cond_t c775DmaCond = PTHREAD_COND_INITIALIZER;
+LOCAL int c775DmaBusy = 0;	/* DMA engine claimed by a transfer */
+#ifdef VXWORKS68K51
+LOCAL int c775Dma68KRet = 0;	/* Result of the (synchronous) 68K DMA */
+#endif
+
+/* Block read data is left in VME (big endian) byte order unless
+   c775SetBlockSwap() asks for it to be swapped, once, after the DMA */
+LOCAL int c775BlockSwap = 0;
+#ifdef VXWORKS
+#define C775_DMA_WORD(w) (w)
+#else
+#define C775_DMA_WORD(w) (c775BlockSwap ? (w) : LSWAP(w))
+#endif
+
+#define C775_ASYNC_IDLE     0
+#define C775_ASYNC_PENDING  1	/* Buffer claimed, DMA being started */
+#define C775_ASYNC_STARTED  2	/* On the bus, completion thread waiting */
+#define C775_ASYNC_DONE     3	/* Finished, result not yet collected */
 
-/* Define Interrupts variables */
-BOOL c775IntRunning = FALSE;	/* running flag */
-int c775IntID = -1;		/* id number of TDC generating interrupts */
-LOCAL VOIDFUNCPTR c775IntRoutine = NULL;	/* user interrupt service routine */
-LOCAL int c775IntArg = 0;	/* arg to user routine */
-LOCAL int c775IntEvCount = 0;	/* Number of Events to generate Interrupt */
-LOCAL UINT32 c775IntLevel = C775_VME_INT_LEVEL;	/* default VME interrupt level */
-LOCAL UINT32 c775IntVec = C775_INT_VEC;	/* default interrupt Vector */
+LOCAL struct
+{
+  int state;
+  c775_ctx *ctx;		/* Context of the TDC being read */
+  int id;			/* TDC being read */
+  int ibuf;			/* Buffer being filled */
+  int nwrds;
+  int retVal;			/* DMA status from the completion thread */
+  int nbufs;
+  int bufwords;
+  int next;			/* Next buffer in rotation */
+  volatile UINT32 *buf[C775_MAX_DMA_BUFS];
+  int bufState[C775_MAX_DMA_BUFS];	/* 1: in use until released */
+  int threadRunning;
+  pthread_t thread;
+} c775Async;
+
+/* Per TDC interrupt state.  Every TDC can interrupt, with its own vector
+   and event threshold: c775Int gets the context and the TDC id as its
+   argument (C775_INT_ANY for the TDC given to c775IntEnable). */
+#define C775_INT_ANY  0xff
+#define C775_INT_ARG(ctx,id)  (((ctx)->index << 8) | ((id) & 0xff))
+typedef struct
+{
+  int enabled;			/* Interrupts enabled on this TDC */
+  UINT32 vector;		/* Interrupt vector, 0: not connected */
+  VOIDFUNCPTR routine;		/* User routine, NULL: readout ring */
+  int arg;			/* Arg to user routine */
+  int evCount;			/* Number of Events to generate Interrupt */
+  unsigned int count;		/* Interrupts taken */
+  unsigned int evRate;		/* Trigger rate estimate (events/s) */
+  unsigned int rate;		/* Interrupts per second */
+  unsigned int flushes;		/* Thresholds dropped by the latency ceiling */
+  unsigned int winCount;	/* Interrupts in the rate window */
+  unsigned long long winStart;	/* Start of the rate window (us) */
+  unsigned long long last;	/* Time of the last interrupt (us) */
+} c775_intstate;
+
+/* Interrupt readout ring.  Without a user routine, the interrupt handler
+   (the only producer) drains the TDC into the slot at head; the consumer
+   takes events from the slot at tail.  head and tail are the only shared
+   state, each on its own cache line, so neither side takes a lock. */
+typedef struct
+{
+  int nslots;			/* 0: ring not in use */
+  int bufwords;
+  volatile UINT32 *buf[C775_MAX_RING_SLOTS];
+  c775_evindex index[C775_MAX_RING_SLOTS];
+  int id[C775_MAX_RING_SLOTS];	/* TDC each buffer was read from */
+  unsigned int head __attribute__ ((aligned (C775_CACHE_LINE)));	/* Slots filled */
+  unsigned int stalled;		/* TDCs (bits) held off with the ring full */
+  unsigned int stalls;		/* Times the ring filled up */
+  unsigned int tail __attribute__ ((aligned (C775_CACHE_LINE)));	/* Slots emptied */
+  int ev;			/* Next event in the tail slot */
+} c775_ring;
+
+/* A crate of TDCs (c775CtxCreate): its boards, their locks and counters,
+   the CBLT/MCST chain and the interrupt settings.  Nothing is shared
+   between contexts but the DMA engine. */
+struct c775_ctx_struct
+{
+  int index;			/* Entry in c775CtxTable, part of the interrupt arg */
+  int maxBoards;		/* Size of the per TDC arrays */
+  int nboards;			/* Number of TDCs in Crate */
+  unsigned int memOffset;	/* CPUs A24 or A32 address space offset */
+  volatile c775_regs **p;	/* pointers to TDC memory map */
+  volatile c775_regs **pl;	/* Support for 68K second memory map A24/D32 */
+  c775_state *state;
+  int stateInitialized;
+  c775_boardinfo *info;		/* Address and ROM data of each TDC */
+  c775_shadow *shadow;		/* Configuration registers of each TDC */
+
+  /* Chained block transfer (CBLT) */
+  UINT32 cbltAdr;		/* VME (A32) address of the chain */
+  volatile c775_regs *cbltp;	/* Local address of the chain */
+  int *geo;			/* GEO address of each TDC in the chain */
+  int geoID[32];		/* TDC id for each GEO address */
+
+  /* Interrupts */
+  c775_intstate *intBd;
+  BOOL intRunning;		/* running flag */
+  int intID;			/* id number of TDC given to c775IntEnable */
+  int intCount;			/* Count of interrupts from TDC */
+  VOIDFUNCPTR intRoutine;	/* user interrupt service routine */
+  int intArg;			/* arg to user routine */
+  UINT32 intLevel;		/* VME interrupt level */
+  UINT32 intVec;		/* interrupt Vector */
+  int intLatency;		/* Latency ceiling (us), 0: fixed evTrigger */
+  c775_ring ring;
+#ifdef VXWORKS
+  SEM_ID sem;			/* Semephore for Task syncronization */
+#else
+  pthread_mutex_t ringMutex;
+  pthread_cond_t ringCond;
+
+  /* Interrupt eventfd (c775IntEventFd).  The handler writes it only when
+     the application has taken everything since the last write, so a
+     burst of interrupts costs one wakeup. */
+  int intFd;
+  unsigned int intFdNotify;	/* Next interrupt writes the eventfd */
+  unsigned int intFdPending;	/* TDCs (bits) held off with data */
+#endif
+};
 
 
-/* Define global variables */
+/* Define global variables.  These are the default context, used by the
+   functions without a context argument; Nc775, c775MemOffset and the
+   CBLT address are kept up to date with it. */
 int Nc775 = 0;			/* Number of TDCs in Crate */
-volatile c775_regs *c775p[20];	/* pointers to TDC memory map */
-volatile c775_regs *c775pl[20];	/* Support for 68K second memory map A24/D32 */
-int c775IntCount = 0;		/* Count of interrupts from TDC */
-int c775EventCount[20];		/* Count of Events taken by TDC (Event Count Register value) */
-int c775EvtReadCnt[20];		/* Count of events read from specified TDC */
+volatile c775_regs *c775p[C775_MAX_BOARDS];	/* pointers to TDC memory map */
+volatile c775_regs *c775pl[C775_MAX_BOARDS];	/* Support for 68K second memory map A24/D32 */
 unsigned int c775MemOffset = 0;	/* CPUs A24 or A32 address space offset */
 
-#ifdef VXWORKS
-SEM_ID c775Sem;			/* Semephore for Task syncronization */
+/* Chained block transfer (CBLT) variables */
+UINT32 c775CBLTAdr = 0;		/* VME (A32) address of the chain */
+volatile c775_regs *c775CBLTp = NULL;	/* Local address of the chain */
+int c775Geo[C775_MAX_BOARDS];	/* GEO address of each TDC in the chain */
+
+LOCAL c775_state c775State[C775_MAX_BOARDS];
+LOCAL c775_boardinfo c775Info[C775_MAX_BOARDS];
+LOCAL c775_shadow c775Shadow[C775_MAX_BOARDS];
+LOCAL c775_intstate c775IntBd[C775_MAX_BOARDS];
+
+LOCAL c775_ctx c775DefaultCtx = {
+  .index = 0,
+  .maxBoards = C775_MAX_BOARDS,
+  .p = c775p,
+  .pl = c775pl,
+  .state = c775State,
+  .info = c775Info,
+  .shadow = c775Shadow,
+  .geo = c775Geo,
+  .intBd = c775IntBd,
+  .intID = -1,
+  .intLevel = C775_VME_INT_LEVEL,
+  .intVec = C775_INT_VEC,
+#ifndef VXWORKS
+  .ringMutex = PTHREAD_MUTEX_INITIALIZER,
+  .ringCond = PTHREAD_COND_INITIALIZER,
+  .intFd = -1,
+  .intFdNotify = 1,
 #endif
+};
+
+/* Contexts by index, for the interrupt handler */
+LOCAL c775_ctx *c775CtxTable[C775_MAX_CTX] = { &c775DefaultCtx };
+LOCAL pthread_mutex_t c775CtxMutex = PTHREAD_MUTEX_INITIALIZER;
+
+LOCAL void
+c775LockAll(c775_ctx * ctx)
+{
+  int ii;
+
+  for (ii = 0; ii < ctx->nboards; ii++)
+    {
+      C775LOCK(ii);
+    }
+}
+
+LOCAL void
+c775UnlockAll(c775_ctx * ctx)
+{
+  int ii;
+
+  for (ii = ctx->nboards - 1; ii >= 0; ii--)
+    {
+      C775UNLOCK(ii);
+    }
+}
 
 /* Macros */
 #define C775_EXEC_SOFT_RESET(id) {					\
-    vmeWrite16(&c775p[id]->main.bitSet1, C775_SOFT_RESET);			\
-    vmeWrite16(&c775p[id]->main.bitClear1, C775_SOFT_RESET);}
+    vmeWrite16(&ctx->p[id]->main.bitSet1, C775_SOFT_RESET);			\
+    vmeWrite16(&ctx->p[id]->main.bitClear1, C775_SOFT_RESET);		\
+    c775ShadowReset(&ctx->shadow[id]);}
 
 #define C775_EXEC_DATA_RESET(id) {					\
-    vmeWrite16(&c775p[id]->main.bitSet2, C775_DATA_RESET);			\
-    vmeWrite16(&c775p[id]->main.bitClear2, C775_DATA_RESET);}
+    vmeWrite16(&ctx->p[id]->main.bitSet2, C775_DATA_RESET);			\
+    vmeWrite16(&ctx->p[id]->main.bitClear2, C775_DATA_RESET);}
 
 #define C775_EXEC_READ_EVENT_COUNT(id) {				\
     volatile unsigned short s1, s2;					\
-    s1 = vmeRead16(&c775p[id]->main.evCountL);				\
-    s2 = vmeRead16(&c775p[id]->main.evCountH);				\
-    c775EventCount[id] = (c775EventCount[id]&0xff000000) +		\
+    s1 = vmeRead16(&ctx->p[id]->main.evCountL);				\
+    s2 = vmeRead16(&ctx->p[id]->main.evCountH);				\
+    ctx->state[id].eventCount = (ctx->state[id].eventCount&0xff000000) +		\
       (s2<<16) +							\
       (s1);}
 #define C775_EXEC_SET_EVTREADCNT(id,val) {				\
-    if(c775EvtReadCnt[id] < 0)						\
-      c775EvtReadCnt[id] = val;						\
+    if(ctx->state[id].evtReadCnt < 0)						\
+      ctx->state[id].evtReadCnt = val;						\
     else								\
-      c775EvtReadCnt[id] = (c775EvtReadCnt[id]&0x7f000000) + val;}
+      ctx->state[id].evtReadCnt = (ctx->state[id].evtReadCnt&0x7f000000) + val;}
+
+/* Signed difference of two 24 bit event counts, across the wrap */
+#define C775_EVDIFF(cnt,rd)						\
+  ((int) ((((cnt) - (rd)) & 0xffffff) ^ 0x800000) - 0x800000)
+/* Events seen ready by c775DreadyFast and not read yet */
+#define C775_EVPENDING(id)						\
+  C775_EVDIFF(ctx->state[id].evReady, ctx->state[id].evtReadCnt)
+#define C775_EXEC_FORGET_READY(id) {			\
+    ctx->state[id].evReady = ctx->state[id].evtReadCnt;}
 
 #define C775_EXEC_CLR_EVENT_COUNT(id) {		\
-    vmeWrite16(&c775p[id]->main.evCountReset, 1);	\
-    c775EventCount[id] = 0;}
+    vmeWrite16(&ctx->p[id]->main.evCountReset, 1);	\
+    ctx->state[id].eventCount = 0;				\
+    C775_EXEC_FORGET_READY(id);}
 #define C775_EXEC_INCR_EVENT(id) {			\
-    vmeWrite16(&c775p[id]->main.incrEvent, 1);		\
-    c775EvtReadCnt[id]++;}
+    vmeWrite16(&ctx->p[id]->main.incrEvent, 1);		\
+    ctx->state[id].evtReadCnt++;}
 #define C775_EXEC_INCR_WORD(id) {		\
-    vmeWrite16(&c775p[id]->main.incrOffset, 1);}
+    vmeWrite16(&ctx->p[id]->main.incrOffset, 1);}
 #define C775_EXEC_GATE(id) {			\
-    vmeWrite16(&c775p[id]->main.swComm, 1);}
+    vmeWrite16(&ctx->p[id]->main.swComm, 1);}
+
+/* Configuration registers are written through the shadow (c775GetShadow),
+   so that reading them back never needs the bus */
+#define C775_WRITE(id,reg,val) {				\
+    ctx->shadow[id].reg = (val);				\
+    vmeWrite16(&ctx->p[id]->main.reg, ctx->shadow[id].reg);}
+#define C775_BITSET2(id,val) {					\
+    ctx->shadow[id].bitSet2 |= (val) & ~C775_DATA_RESET;	\
+    vmeWrite16(&ctx->p[id]->main.bitSet2, (val));}
+#define C775_BITCLEAR2(id,val) {				\
+    ctx->shadow[id].bitSet2 &= ~(val);			\
+    vmeWrite16(&ctx->p[id]->main.bitClear2, (val));}
+
+/* Shadowed registers, with the bits that read back */
+#define C775_SHADOW_REG(reg,mask)					\
+  { #reg, offsetof(c775_main, reg), offsetof(c775_shadow, reg), mask }
+
+LOCAL const struct
+{
+  const char *name;
+  int reg;			/* Offset in c775_main */
+  int shadow;			/* Offset in c775_shadow */
+  UINT16 mask;
+} c775ShadowRegs[] =
+{
+  C775_SHADOW_REG(cbltAddr, 0xff),
+  C775_SHADOW_REG(intLevel, C775_INTLEVEL_MASK),
+  C775_SHADOW_REG(intVector, C775_INTVECTOR_MASK),
+  C775_SHADOW_REG(control1, C775_CONTROL1_MASK),
+  C775_SHADOW_REG(cbltControl, 0x3),
+  C775_SHADOW_REG(evTrigger, C775_EVTRIGGER_MASK),
+  C775_SHADOW_REG(fclrWindow, 0x3ff),
+  C775_SHADOW_REG(bitSet2, C775_BITSET2_MASK),
+  C775_SHADOW_REG(crateSelect, 0xff),
+  C775_SHADOW_REG(fsr, C775_FSR_MASK),
+  C775_SHADOW_REG(slideConst, 0xff),
+};
+#define C775_THRESHOLD_MASK 0x1ff
+
+/* Register values after a soft reset.  The CBLT/MCST settings and the
+   Crate ID are kept. */
+LOCAL void
+c775ShadowReset(c775_shadow * sh)
+{
+  sh->intLevel = 0;
+  sh->intVector = 0;
+  sh->control1 = 0;
+  sh->evTrigger = 0;
+  sh->fclrWindow = 0;
+  sh->bitSet2 = 0;
+  sh->fsr = 0xff;
+  sh->slideConst = 0;
+  memset(sh->threshold, 0, sizeof(sh->threshold));
+}
+
+/* Start the shadow of a TDC that is about to be soft reset: only the
+   registers that survive the reset are read */
+#define C775_SHADOW_INIT(id) {						\
+    memset(&ctx->shadow[id], 0, sizeof(c775_shadow));			\
+    ctx->shadow[id].cbltAddr = vmeRead16(&ctx->p[id]->main.cbltAddr);	\
+    ctx->shadow[id].cbltControl = vmeRead16(&ctx->p[id]->main.cbltControl);	\
+    ctx->shadow[id].crateSelect = vmeRead16(&ctx->p[id]->main.crateSelect);}
+
+
+/* Zeroed, cache line aligned memory for a context */
+LOCAL void *
+c775CtxAlloc(int size)
+{
+  void *mem;
+
+#ifdef VXWORKS
+  mem = memalign(C775_CACHE_LINE, size);
+#else
+  if (posix_memalign(&mem, C775_CACHE_LINE, size) != 0)
+    mem = NULL;
+#endif
+  if (mem != NULL)
+    memset(mem, 0, size);
+
+  return (mem);
+}
+
+LOCAL void
+c775CtxFree(c775_ctx * ctx)
+{
+  free(ctx->p);
+  free(ctx->pl);
+  free(ctx->state);
+  free(ctx->info);
+  free(ctx->shadow);
+  free(ctx->geo);
+  free(ctx->intBd);
+  free(ctx);
+}
+
+/*******************************************************************************
+*
+* c775CtxCreate - Create a library context for a crate (or a set) of TDCs.
+*
+*    A context owns its TDCs, their locks and event counters, its CBLT/MCST
+*    chain, interrupt settings and readout ring, so that independent
+*    readout threads, each with its own boards, share no state.  Every
+*    library call has a c775Ctx... form taking the context as its first
+*    argument (c775CtxInit, c775CtxReadEvents, ...); the calls without one
+*    work on the default context (c775CtxDefault).
+*
+*    Contexts do share the DMA engine (c775ReadBlockStart and friends) and
+*    the VME interrupt levels: give the TDCs of each context their own
+*    interrupt vectors.
+*
+* INPUTS:    maxBoards - number of TDCs the context can hold
+*                        (1 - C775_CTX_MAX_BOARDS)
+*
+* RETURNS: The new context, or NULL.
+*/
+
+c775_ctx *
+c775CtxCreate(int maxBoards)
+{
+  c775_ctx *ctx;
+  int index;
+
+  if ((maxBoards < 1) || (maxBoards > C775_CTX_MAX_BOARDS))
+    {
+      printf("c775CtxCreate: ERROR: Invalid number of TDCs (%d). Must be (1-%d)\n",
+	     maxBoards, C775_CTX_MAX_BOARDS);
+      return (NULL);
+    }
+
+  ctx = c775CtxAlloc(sizeof(c775_ctx));
+  if (ctx == NULL)
+    {
+      printf("c775CtxCreate: ERROR: Out of memory\n");
+      return (NULL);
+    }
+  ctx->p = c775CtxAlloc(maxBoards * sizeof(*ctx->p));
+  ctx->pl = c775CtxAlloc(maxBoards * sizeof(*ctx->pl));
+  ctx->state = c775CtxAlloc(maxBoards * sizeof(c775_state));
+  ctx->info = c775CtxAlloc(maxBoards * sizeof(c775_boardinfo));
+  ctx->shadow = c775CtxAlloc(maxBoards * sizeof(c775_shadow));
+  ctx->geo = c775CtxAlloc(maxBoards * sizeof(int));
+  ctx->intBd = c775CtxAlloc(maxBoards * sizeof(c775_intstate));
+  if ((ctx->p == NULL) || (ctx->pl == NULL) || (ctx->state == NULL)
+      || (ctx->info == NULL) || (ctx->shadow == NULL) || (ctx->geo == NULL)
+      || (ctx->intBd == NULL))
+    {
+      printf("c775CtxCreate: ERROR: Out of memory\n");
+      c775CtxFree(ctx);
+      return (NULL);
+    }
+
+  ctx->maxBoards = maxBoards;
+  ctx->intID = -1;
+  ctx->intLevel = C775_VME_INT_LEVEL;
+  ctx->intVec = C775_INT_VEC;
+#ifndef VXWORKS
+  pthread_mutex_init(&ctx->ringMutex, NULL);
+  pthread_cond_init(&ctx->ringCond, NULL);
+  ctx->intFd = -1;
+  ctx->intFdNotify = 1;
+#endif
+
+  /* Index 0 is the default context */
+  pthread_mutex_lock(&c775CtxMutex);
+  for (index = 1; index < C775_MAX_CTX; index++)
+    {
+      if (c775CtxTable[index] == NULL)
+	break;
+    }
+  if (index < C775_MAX_CTX)
+    {
+      ctx->index = index;
+      c775CtxTable[index] = ctx;
+    }
+  pthread_mutex_unlock(&c775CtxMutex);
+
+  if (index == C775_MAX_CTX)
+    {
+      printf("c775CtxCreate: ERROR: Too many contexts (%d)\n", C775_MAX_CTX);
+      c775CtxFree(ctx);
+      return (NULL);
+    }
+
+  return (ctx);
+}
+
+/*******************************************************************************
+*
+* c775CtxDestroy - Free a context made by c775CtxCreate.  The TDCs are
+*                  left as they are.
+*
+* RETURNS: OK, or ERROR for the default context or if interrupts or a
+*          block read are still running on it.
+*/
+
+STATUS
+c775CtxDestroy(c775_ctx * ctx)
+{
+  int ii;
+
+  if ((ctx == NULL) || (ctx == &c775DefaultCtx))
+    {
+      printf("c775CtxDestroy: ERROR: Invalid context\n");
+      return (ERROR);
+    }
+
+  if (ctx->intRunning)
+    {
+      printf("c775CtxDestroy: ERROR : Interrupts are running\n");
+      return (ERROR);
+    }
+
+  pthread_mutex_lock(&c775DmaMutex);
+  ii = (c775Async.state != C775_ASYNC_IDLE) && (c775Async.ctx == ctx);
+  pthread_mutex_unlock(&c775DmaMutex);
+  if (ii)
+    {
+      printf("c775CtxDestroy: ERROR : Block read in progress\n");
+      return (ERROR);
+    }
+
+  pthread_mutex_lock(&c775CtxMutex);
+  c775CtxTable[ctx->index] = NULL;
+  pthread_mutex_unlock(&c775CtxMutex);
+
+  if (ctx->stateInitialized)
+    {
+      for (ii = 0; ii < ctx->maxBoards; ii++)
+	pthread_mutex_destroy(&ctx->state[ii].mutex);
+    }
+#ifdef VXWORKS
+  if (ctx->sem != 0)
+    semDelete(ctx->sem);
+#else
+  c775CtxIntEventFdClose(ctx);
+  pthread_mutex_destroy(&ctx->ringMutex);
+  pthread_cond_destroy(&ctx->ringCond);
+#endif
+  c775CtxFree(ctx);
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxDefault - Return the default context, the one used by the calls
+*                  without a context argument.
+* c775CtxNBoards - Return the number of TDCs initialized in a context.
+*
+*/
+
+c775_ctx *
+c775CtxDefault(void)
+{
+  return (&c775DefaultCtx);
+}
+
+int
+c775CtxNBoards(c775_ctx * ctx)
+{
+  return (ctx->nboards);
+}
+
+/* Per TDC locks of a context, made on its first initialization */
+LOCAL void
+c775StateInit(c775_ctx * ctx)
+{
+  int ii;
+
+  if (!ctx->stateInitialized)
+    {
+      for (ii = 0; ii < ctx->maxBoards; ii++)
+	pthread_mutex_init(&ctx->state[ii].mutex, NULL);
+      ctx->stateInitialized = 1;
+    }
+}
+
+/* 1 if the Event Counter (evCountL/evCountH) of a TDC can be read with
+   one D32 cycle, as c775DreadyFast does: the registers are D16 only in
+   the manual, so the bridge must split the cycle.  Checked against two
+   D16 reads, again if the counter moves in between. */
+LOCAL int
+c775CountProbe(c775_ctx * ctx, int id)
+{
+  int res, itry;
+  UINT32 d32;
+  UINT16 lo, hi;
+
+  for (itry = 0; itry < 3; itry++)
+    {
+      lo = vmeRead16(&ctx->p[id]->main.evCountL);
+      hi = vmeRead16(&ctx->p[id]->main.evCountH) & 0xff;
+#ifdef VXWORKS
+      res = vxMemProbe((char *) &(ctx->p[id]->main.evCountL), 0, 4,
+		       (char *) &d32);
+#else
+      res = vmeMemProbe((char *) &(ctx->p[id]->main.evCountL), 4,
+			(char *) &d32);
+#endif
+      if (res < 0)
+	return (0);
+      if ((lo == vmeRead16(&ctx->p[id]->main.evCountL))
+	  && (hi == (vmeRead16(&ctx->p[id]->main.evCountH) & 0xff)))
+	return (d32 == (((UINT32) lo << 16) | hi));
+    }
+  return (0);
+}
+
+/* Common end of c775Init and c775Discover: zero the counters of the TDCs
+   found, create the task semaphore and clear the interrupt variables */
+LOCAL STATUS
+c775InitDone(c775_ctx * ctx)
+{
+  int ii;
+
+  for (ii = 0; ii < ctx->nboards; ii++)
+    {
+      ctx->state[ii].eventCount = 0;	/* Initialize the Event Count */
+      ctx->state[ii].evtReadCnt = -1;	/* Initialize the Read Count */
+      ctx->state[ii].evReady = -1;
+      ctx->state[ii].singleOwner = 0;
+      ctx->state[ii].d32Count = c775CountProbe(ctx, ii);
+    }
+
+#ifdef VXWORKS
+  /* Initialize/Create Semephore */
+  if (ctx->sem != 0)
+    {
+      semFlush(ctx->sem);
+      semDelete(ctx->sem);
+    }
+  ctx->sem = semBCreate(SEM_Q_PRIORITY, SEM_EMPTY);
+  if (ctx->sem <= 0)
+    {
+      printf("c775Init: ERROR: Unable to create Binary Semephore\n");
+      return (ERROR);
+    }
+#endif
+
+  /* Initialize Interrupt variables */
+  ctx->intID = -1;
+  ctx->intRunning = FALSE;
+  ctx->intLevel = 0;
+  ctx->intVec = 0;
+  ctx->intRoutine = NULL;
+  ctx->intArg = 0;
+  memset(ctx->intBd, 0, ctx->maxBoards * sizeof(c775_intstate));
+
+  return (OK);
+}
+
+/* Disable interrupts, set the Crate ID, count accepted gates only, keep
+   empty events, disable Overflow/Underflow suppression and set the
+   minimum Full Scale Range: c775Init's setup of a TDC, without reading
+   anything back.  tp is a TDC, or the MCST address of the chain. */
+LOCAL void
+c775Setup(volatile c775_regs * tp, UINT16 crateID)
+{
+  vmeWrite16(&tp->main.intLevel, 0);
+  vmeWrite16(&tp->main.evTrigger, 0);
+  vmeWrite16(&tp->main.crateSelect, crateID);
+  vmeWrite16(&tp->main.bitClear2, C775_INCR_ALL_TRIG | C775_INC_HEADER);
+  vmeWrite16(&tp->main.bitSet2, C775_OVER_RANGE | C775_LOW_THRESHOLD);
+  vmeWrite16(&tp->main.fsr, 290 - (C775_MIN_FSR >> 2));
+}
 
+/* The same, in the shadow of a TDC */
+LOCAL void
+c775SetupShadow(c775_shadow * sh, UINT16 crateID)
+{
+  sh->intLevel = 0;
+  sh->evTrigger = 0;
+  sh->crateSelect = crateID;
+  sh->bitSet2 &= ~(C775_INCR_ALL_TRIG | C775_INC_HEADER);
+  sh->bitSet2 |= C775_OVER_RANGE | C775_LOW_THRESHOLD;
+  sh->fsr = 290 - (C775_MIN_FSR >> 2);
+}
 
 /*******************************************************************************
 *
-* c775Init - Initialize c775 Library. 
+* c775CtxInit - Initialize c775 Library. 
 *
 *
 * RETURNS: OK, or ERROR if the address is invalid or board is not present.
 */
 
 STATUS
-c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
+c775CtxInit(c775_ctx * ctx, UINT32 addr, UINT32 addr_inc, int ntdc,
+	    UINT16 crateID)
 {
   int ii, res, rdata, errFlag = 0;
   int boardID = 0;
@@ -145,14 +744,15 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 	  return (ERROR);
 	}
 #else
-      res = vmeBusToLocalAdrs(0x39, (char *) addr, (char **) &laddr);
+      res = vmeBusToLocalAdrs(0x39, (char *) (unsigned long) addr,
+			      (char **) &laddr);
       if (res != 0)
 	{
 	  printf("c775Init: ERROR in vmeBusToLocalAdrs(0x39,0x%x,&laddr) \n",
 		 addr);
 	  return (ERROR);
 	}
-      c775MemOffset = laddr - addr;
+      ctx->memOffset = laddr - addr;
 #endif
     }
   else
@@ -177,7 +777,8 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 	  return (ERROR);
 	}
 #else
-      res = vmeBusToLocalAdrs(0x09, (char *) addr, (char **) &laddr);
+      res = vmeBusToLocalAdrs(0x09, (char *) (unsigned long) addr,
+			      (char **) &laddr);
       if (res != 0)
 	{
 	  printf("c775Init: ERROR in vmeBusToLocalAdrs(0x09,0x%x,&laddr) \n",
@@ -185,7 +786,7 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 	  return (ERROR);
 	}
 #endif
-      c775MemOffset = laddr - addr;
+      ctx->memOffset = laddr - addr;
     }
 
   /* Put in Hack for 68K seperate address spaces for A24/D16 and A24/D32 */
@@ -197,22 +798,32 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 #endif
 
 
-  Nc775 = 0;
+  if (ntdc > ctx->maxBoards)
+    {
+      printf("c775Init: ERROR: Context holds %d TDCs (ntdc = %d)\n",
+	     ctx->maxBoards, ntdc);
+      return (ERROR);
+    }
+
+  c775StateInit(ctx);
+
+  ctx->nboards = 0;
+  memset(ctx->info, 0, ctx->maxBoards * sizeof(c775_boardinfo));
   for (ii = 0; ii < ntdc; ii++)
     {
-      c775p[ii] = (c775_regs *) (laddr + ii * addr_inc);
-      c775pl[ii] = (c775_regs *) (lladdr + ii * addr_inc);
+      ctx->p[ii] = (c775_regs *) (laddr + ii * addr_inc);
+      ctx->pl[ii] = (c775_regs *) (lladdr + ii * addr_inc);
       /* Check if Board exists at that address */
 #ifdef VXWORKS
-      res = vxMemProbe((char *) &(c775p[ii]->main.rev), 0, 2, (char *) &rdata);
+      res = vxMemProbe((char *) &(ctx->p[ii]->main.rev), 0, 2, (char *) &rdata);
 #else
-      res = vmeMemProbe((char *) &(c775p[ii]->main.rev), 2, (char *) &rdata);
+      res = vmeMemProbe((char *) &(ctx->p[ii]->main.rev), 2, (char *) &rdata);
 #endif
       if (res < 0)
 	{
-	  printf("c775Init: ERROR: No addressable board at addr=0x%x\n",
-		 (UINT32) c775p[ii]);
-	  c775p[ii] = NULL;
+	  printf("c775Init: ERROR: No addressable board at addr=0x%lx\n",
+		 (unsigned long) ctx->p[ii]);
+	  ctx->p[ii] = NULL;
 	  errFlag = 1;
 	  break;
 	}
@@ -233,16 +844,18 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 	return(ERROR);
       }
       
-      rp = (c775_ROM *) ((UINT32) &c775p[ii]->rom);  // original way to set rp
-      rp = (struct c775_ROM *) ((UINT32) &c775p[ii] + c775MemOffset);
+      rp = (c775_ROM *) ((UINT32) &ctx->p[ii]->rom);  // original way to set rp
+      rp = (struct c775_ROM *) ((UINT32) &ctx->p[ii] + ctx->memOffset);
       rp = (struct c792_ROM_struct *)((UINT32)c792p[ii] + C792_ROM_OFFSET);
 	*****************************************/
 	
 	  /* Check if this is a Model 775 */
 	  
-	  rp = (c775_ROM *) ((UINT32) &c775p[ii]->rom);  
+	  rp = (c775_ROM *) &ctx->p[ii]->rom;
 
-	  printf("laddr= 0x%11x , &laddr= 0x%11x ,  rp= 0x%11x &rp= 0x%11x     \n",laddr,&laddr,rp,&rp);
+	  printf("laddr= 0x%11lx , &laddr= 0x%11lx ,  rp= 0x%11lx &rp= 0x%11lx     \n",
+		 laddr, (unsigned long) &laddr, (unsigned long) rp,
+		 (unsigned long) &rp);
 	  
 	  id3=((vmeRead16(&rp->ID_3) & (0xff)) << 16);
 	  id2=((vmeRead16(&rp->ID_2) & (0xff)) << 8);
@@ -259,69 +872,50 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 	      return (ERROR);
 	    }
 	}
-      Nc775++;
+      ctx->info[ii].vmeAddr = addr + ii * addr_inc;
+      ctx->info[ii].firmware = vmeRead16(&ctx->p[ii]->main.rev);
+      ctx->nboards++;
 #ifdef VXWORKS
       printf("Initialized TDC ID %d at address 0x%08x \n", ii,
-	     (UINT32) c775p[ii]);
+	     (UINT32) ctx->p[ii]);
 #else
-      printf("Initialized TDC ID %d at VME (LOCAL) address 0x%x (0x%x)\n", ii,
-	     (UINT32) c775p[ii] - c775MemOffset, (UINT32) c775p[ii]);
+      printf("Initialized TDC ID %d at VME (LOCAL) address 0x%lx (0x%lx)\n",
+	     ii, (unsigned long) ctx->p[ii] - ctx->memOffset,
+	     (unsigned long) ctx->p[ii]);
 #endif
     }
 
-#ifdef VXWORKS
-  /* Initialize/Create Semephore */
-  if (c775Sem != 0)
-    {
-      semFlush(c775Sem);
-      semDelete(c775Sem);
-    }
-  c775Sem = semBCreate(SEM_Q_PRIORITY, SEM_EMPTY);
-  if (c775Sem <= 0)
-    {
-      printf("c775Init: ERROR: Unable to create Binary Semephore\n");
-      return (ERROR);
-    }
-#endif
+  if (c775InitDone(ctx) != OK)
+    return (ERROR);
 
   /* Disable/Clear all TDCs */
-  for (ii = 0; ii < Nc775; ii++)
+  for (ii = 0; ii < ctx->nboards; ii++)
     {
+      C775_SHADOW_INIT(ii);
       C775_EXEC_SOFT_RESET(ii);
       C775_EXEC_DATA_RESET(ii);
       /* Disable Interrupts */
-      vmeWrite16(&c775p[ii]->main.intLevel, 0);
+      C775_WRITE(ii, intLevel, 0);
       /* Zero interrupt trigger count */
-      vmeWrite16(&c775p[ii]->main.evTrigger, 0);
+      C775_WRITE(ii, evTrigger, 0);
       /* Set Crate ID Register */
-      vmeWrite16(&c775p[ii]->main.crateSelect, crateID);
+      C775_WRITE(ii, crateSelect, crateID);
       /* Increment event count only on accepted gates */
-      vmeWrite16(&c775p[ii]->main.bitClear2, C775_INCR_ALL_TRIG);
+      C775_BITCLEAR2(ii, C775_INCR_ALL_TRIG);
       /* Turn off suppression of header and EOB if no accepted channels */
-      vmeWrite16(&c775p[ii]->main.bitClear2, C775_INC_HEADER);
+      C775_BITCLEAR2(ii, C775_INC_HEADER);
 
-      c775EventCount[ii] = 0;	/* Initialize the Event Count */
-      c775EvtReadCnt[ii] = -1;	/* Initialize the Read Count */
+      c775CtxSetFSR(ctx, ii, C775_MIN_FSR);	/* Set Full Scale Range for TDC */
 
-      c775SetFSR(ii, C775_MIN_FSR);	/* Set Full Scale Range for TDC */
-
-      c775Sparse(ii, 0, 0);	/* Disable Overflow/Underflow suppression */
+      c775CtxSparse(ctx, ii, 0, 0);	/* Disable Overflow/Underflow suppression */
     }
-  /* Initialize Interrupt variables */
-  c775IntID = -1;
-  c775IntRunning = FALSE;
-  c775IntLevel = 0;
-  c775IntVec = 0;
-  c775IntRoutine = NULL;
-  c775IntArg = 0;
-  c775IntEvCount = 0;
 
 
   if (errFlag > 0)
     {
       printf("c775Init: ERROR: Unable to initialize all TDC Modules\n");
-      if (Nc775 > 0)
-	printf("c7752Init: %d TDC(s) successfully initialized\n", Nc775);
+      if (ctx->nboards > 0)
+	printf("c7752Init: %d TDC(s) successfully initialized\n", ctx->nboards);
       return (ERROR);
     }
   else
@@ -332,70 +926,279 @@ c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
 
 /*******************************************************************************
 *
-* c775Status - Gives Status info on specified TDC
+* c775CtxDiscover - Find and initialize every TDC in a range of addresses.
 *
+*    Each slot from addr to addr_end (every addr_inc) is probed.  A board
+*    with the 775 ROM ID becomes the next TDC id, and its serial number
+*    and revision are read in the same pass (c775GetBoardInfo).  Empty
+*    slots and other modules are skipped, not fatal.  The TDCs found are
+*    reset and set up as c775Init does, without reading anything back,
+*    and a single line is printed for the crate.
 *
-* RETURNS: None
+*    With an MCST address (and at least 2 TDCs) the TDCs are chained
+*    (c775MCSTInit) and the setup is written to all of them at once; the
+*    chain is then also ready for c775ReadCBLT.  This needs the TDCs in
+*    adjacent slots: if the TDCs found leave a gap, they are set up one
+*    by one and no chain is made.
+*
+* INPUTS:    addr     - VME address (A24 or A32) of the first slot to probe
+*            addr_end - VME address of the last slot to probe
+*            addr_inc - address step from slot to slot (>= 0x10000)
+*            crateID  - Crate ID written to every TDC
+*            mcstAddr - A32 MCST/CBLT address of the chain (0xXX000000),
+*                       0 to set the TDCs up one by one
+*
+* RETURNS: Number of TDCs found, or ERROR.
 */
 
-void
-c775Status(int id)
+int
+c775CtxDiscover(c775_ctx * ctx, UINT32 addr, UINT32 addr_end, UINT32 addr_inc,
+		UINT16 crateID, UINT32 mcstAddr)
 {
+  int ii, id, res, am, nslots, rdata, nempty = 0, nother = 0, mcst = 0;
+  int first = -1, last = -1;
+  unsigned long laddr, lladdr;
+  volatile c775_regs *tp;
+  volatile c775_ROM *rp;
+  UINT32 vaddr, boardID;
 
-  int DRdy = 0, BufFull = 0;
-  UINT16 stat1, stat2, bit1, bit2, cntl1, rev;
-  UINT16 iLvl, iVec, evTrig;
-  UINT16 fsr;
-
-  if ((id < 0) || (c775p[id] == NULL))
+  if ((addr == 0) || (addr_end < addr) || (addr_inc < 0x10000))
     {
-      printf("c775Status: ERROR : TDC id %d not initialized \n", id);
-      return;
+      printf("c775Discover: ERROR: Invalid address range 0x%x - 0x%x (step 0x%x)\n",
+	     addr, addr_end, addr_inc);
+      return (ERROR);
     }
 
+  if (addr_end < 0x00ffffff)
+    am = 0x39;			/* A24 Addressing */
+  else if (addr < 0x00ffffff)
+    {
+      printf("c775Discover: ERROR: Address range 0x%x - 0x%x spans A24 and A32\n",
+	     addr, addr_end);
+      return (ERROR);
+    }
+  else
+    {				/* A32 Addressing */
+#ifdef VXWORKS68K51
+      printf
+	("c775Discover: ERROR: 68K Based CPU cannot support A32 addressing (use A24)\n");
+      return (ERROR);
+#endif
+      am = 0x09;
+    }
 
-  /* read various registers */
-  C775LOCK;
-  rev = vmeRead16(&c775p[id]->main.rev);
-  stat1 = vmeRead16(&c775p[id]->main.status1) & C775_STATUS1_MASK;
-  stat2 = vmeRead16(&c775p[id]->main.status2) & C775_STATUS2_MASK;
-  bit1 = vmeRead16(&c775p[id]->main.bitSet1) & C775_BITSET1_MASK;
-  bit2 = vmeRead16(&c775p[id]->main.bitSet2) & C775_BITSET2_MASK;
-  cntl1 = vmeRead16(&c775p[id]->main.control1) & C775_CONTROL1_MASK;
-  fsr = 4 * (290 - (vmeRead16(&c775p[id]->main.fsr) & C775_FSR_MASK));
-  C775_EXEC_READ_EVENT_COUNT(id);
-  if (stat1 & C775_DATA_READY)
-    DRdy = 1;
-  if (stat2 & C775_BUFFER_FULL)
-    BufFull = 1;
+#ifdef VXWORKS
+  res = sysBusToLocalAdrs(am, (char *) addr, (char **) &laddr);
+#else
+  res = vmeBusToLocalAdrs(am, (char *) (unsigned long) addr,
+			  (char **) &laddr);
+#endif
+  if (res != 0)
+    {
+      printf("c775Discover: ERROR in BusToLocalAdrs(0x%x,0x%x,&laddr) \n", am,
+	     addr);
+      return (ERROR);
+    }
+  ctx->memOffset = laddr - addr;
 
-  iLvl = vmeRead16(&c775p[id]->main.intLevel) & C775_INTLEVEL_MASK;
-  iVec = vmeRead16(&c775p[id]->main.intVector) & C775_INTVECTOR_MASK;
-  evTrig = vmeRead16(&c775p[id]->main.evTrigger) & C775_EVTRIGGER_MASK;
-  C775UNLOCK;
+  /* Put in Hack for 68K seperate address spaces for A24/D16 and A24/D32 */
+#ifdef VXWORKS68K51
+  lladdr = C775_68K_A24D32_OFFSET + (laddr & 0x00ffffff);
+#else
+  lladdr = laddr;
+#endif
 
-  /* print out status info */
+  c775StateInit(ctx);
 
+  /* One pass: probe, identify, read the ROM and reset */
+  ctx->nboards = 0;
+  memset(ctx->info, 0, ctx->maxBoards * sizeof(c775_boardinfo));
+  nslots = (addr_end - addr) / addr_inc + 1;
+  for (ii = 0; ii < nslots; ii++)
+    {
+      vaddr = addr + ii * addr_inc;
+      tp = (c775_regs *) (laddr + ii * addr_inc);
 #ifdef VXWORKS
-  printf("STATUS for TDC id %d at base address 0x%x \n", id,
-	 (UINT32) c775p[id]);
+      res = vxMemProbe((char *) &(tp->main.rev), 0, 2, (char *) &rdata);
 #else
-  printf("STATUS for TDC id %d at VME (LOCAL) base address 0x%x (0x%x) \n", id,
-	 (UINT32) c775p[id] - c775MemOffset, (UINT32) c775p[id]);
+      res = vmeMemProbe((char *) &(tp->main.rev), 2, (char *) &rdata);
 #endif
-  printf("--------------------------------------------------------------------------------\n");
-  printf(" Firmware Revision = %d.%d\n", rev >> 8, rev & 0xff);
+      if (res < 0)
+	{
+	  nempty++;
+	  continue;
+	}
 
-  if ((iLvl > 0) && (evTrig > 0))
+      rp = &tp->rom;
+      boardID = ((vmeRead16(&rp->ID_3) & 0xff) << 16) +
+	((vmeRead16(&rp->ID_2) & 0xff) << 8) + (vmeRead16(&rp->ID_1) & 0xff);
+      if (boardID != C775_BOARD_ID)
+	{
+	  nother++;
+	  continue;
+	}
+
+      id = ctx->nboards;
+      if (id == ctx->maxBoards)
+	{
+	  printf("c775Discover: WARN: More TDCs than the context holds (%d)\n",
+		 ctx->maxBoards);
+	  break;
+	}
+      ctx->p[id] = tp;
+      ctx->pl[id] = (c775_regs *) (lladdr + ii * addr_inc);
+      ctx->info[id].vmeAddr = vaddr;
+      ctx->info[id].revision = vmeRead16(&rp->revision) & 0xff;
+      ctx->info[id].serial = ((vmeRead16(&rp->serial_msb) & 0xff) << 8) +
+	(vmeRead16(&rp->serial_lsb) & 0xff);
+      ctx->info[id].firmware = vmeRead16(&tp->main.rev);
+
+      C775_SHADOW_INIT(id);
+      C775_EXEC_SOFT_RESET(id);
+      C775_EXEC_DATA_RESET(id);
+      ctx->nboards++;
+      if (first < 0)
+	first = ii;
+      last = ii;
+    }
+  for (id = ctx->nboards; id < ctx->maxBoards; id++)
+    {
+      ctx->p[id] = NULL;
+      ctx->pl[id] = NULL;
+    }
+  ctx->cbltAdr = 0;
+  ctx->cbltp = NULL;
+
+  if (c775InitDone(ctx) != OK)
+    return (ERROR);
+
+  /* Same setup for every TDC: broadcast it if they can be chained, which
+     a board missing in between would break */
+  if ((mcstAddr != 0) && (ctx->nboards >= 2))
+    {
+      if ((last - first + 1) == ctx->nboards)
+	mcst = (c775CtxMCSTInit(ctx, mcstAddr) == OK);
+      else
+	printf("c775Discover: TDCs not in adjacent slots, no MCST/CBLT chain\n");
+    }
+  if (mcst)
+    c775Setup(ctx->cbltp, crateID);
+  for (id = 0; id < ctx->nboards; id++)
+    {
+      if (!mcst)
+	c775Setup(ctx->p[id], crateID);
+      c775SetupShadow(&ctx->shadow[id], crateID);
+    }
+
+  printf("c775Discover: %d TDC(s) at 0x%x - 0x%x (%d empty, %d other)%s\n",
+	 ctx->nboards, addr, addr_end, nempty, nother,
+	 mcst ? ", set up by MCST" : "");
+
+  return (ctx->nboards);
+}
+
+/*******************************************************************************
+*
+* c775CtxGetBoardInfo - Return the VME address, firmware, serial number and
+*                       revision of a TDC (serial and revision: c775Discover
+*                       only)
+*
+* RETURNS: OK, or ERROR if the TDC is not initialized.
+*/
+
+STATUS
+c775CtxGetBoardInfo(c775_ctx * ctx, int id, c775_boardinfo * info)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775GetBoardInfo: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  *info = ctx->info[id];
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxStatus - Gives Status info on specified TDC
+*
+*
+* RETURNS: None
+*/
+
+void
+c775CtxStatus(c775_ctx * ctx, int id)
+{
+
+  int DRdy = 0, BufFull = 0;
+  UINT16 stat1, stat2, bit1, bit2, cntl1, rev;
+  c775_shadow *sh;
+  UINT16 iLvl, iVec, evTrig;
+  UINT16 fsr;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      printf("c775Status: ERROR : TDC id %d not initialized \n", id);
+      return;
+    }
+
+
+  /* read the status registers, the configuration comes from the shadow
+     (c775Verify compares it with the TDC) */
+  C775LOCK(id);
+  stat1 = vmeRead16(&ctx->p[id]->main.status1) & C775_STATUS1_MASK;
+  stat2 = vmeRead16(&ctx->p[id]->main.status2) & C775_STATUS2_MASK;
+  bit1 = vmeRead16(&ctx->p[id]->main.bitSet1) & C775_BITSET1_MASK;
+  C775_EXEC_READ_EVENT_COUNT(id);
+  if (stat1 & C775_DATA_READY)
+    DRdy = 1;
+  if (stat2 & C775_BUFFER_FULL)
+    BufFull = 1;
+
+  sh = &ctx->shadow[id];
+  rev = ctx->info[id].firmware;
+  bit2 = sh->bitSet2 & C775_BITSET2_MASK;
+  cntl1 = sh->control1 & C775_CONTROL1_MASK;
+  fsr = 4 * (290 - (sh->fsr & C775_FSR_MASK));
+  iLvl = sh->intLevel & C775_INTLEVEL_MASK;
+  iVec = sh->intVector & C775_INTVECTOR_MASK;
+  evTrig = sh->evTrigger & C775_EVTRIGGER_MASK;
+  C775UNLOCK(id);
+
+  /* print out status info */
+
+#ifdef VXWORKS
+  printf("STATUS for TDC id %d at base address 0x%x \n", id,
+	 (UINT32) ctx->p[id]);
+#else
+  printf("STATUS for TDC id %d at VME (LOCAL) base address 0x%lx (0x%lx) \n",
+	 id, (unsigned long) ctx->p[id] - ctx->memOffset,
+	 (unsigned long) ctx->p[id]);
+#endif
+  printf("--------------------------------------------------------------------------------\n");
+  printf(" Firmware Revision = %d.%d\n", rev >> 8, rev & 0xff);
+
+  if ((iLvl > 0) && (evTrig > 0))
     {
       printf(" Interrupts Enabled - Every %d events\n", evTrig);
       printf(" VME Interrupt Level: %d   Vector: 0x%x \n", iLvl, iVec);
-      printf(" Interrupt Count    : %d \n", c775IntCount);
+      printf(" Interrupt Count    : %u   (%u/s)\n", ctx->intBd[id].count,
+	     ctx->intBd[id].rate);
+      if (ctx->intLatency > 0)
+	printf(" Adaptive Threshold : %d events, %u Hz trigger rate,"
+	       " %d us ceiling\n", ctx->intBd[id].evCount, ctx->intBd[id].evRate,
+	       ctx->intLatency);
+      if (ctx->ring.nslots > 0)
+	printf(" Readout Ring       : %d events waiting, %d buffers, %u stalls\n",
+	       c775CtxIntRingCount(ctx), ctx->ring.nslots, ctx->ring.stalls);
     }
   else
     {
       printf(" Interrupts Disabled\n");
-      printf(" Last Interrupt Count    : %d \n", c775IntCount);
+      printf(" Last Interrupt Count    : %u \n", ctx->intBd[id].count);
     }
   printf("\n");
 
@@ -435,18 +1238,18 @@ c775Status(int id)
   printf("\n");
 
   printf("  FSR     = %d nsec\n", fsr);
-  if (c775EventCount[id] == 0xffffff)
+  if (ctx->state[id].eventCount == 0xffffff)
     {
       printf("  Event Count     = (No Events Taken)\n");
       printf("  Last Event Read = (No Events Read)\n");
     }
   else
     {
-      printf("  Event Count     = %d\n", c775EventCount[id]);
-      if (c775EvtReadCnt[id] == -1)
+      printf("  Event Count     = %d\n", ctx->state[id].eventCount);
+      if (ctx->state[id].evtReadCnt == -1)
 	printf("  Last Event Read = (No Events Read)\n");
       else
-	printf("  Last Event Read = %d\n", c775EvtReadCnt[id]);
+	printf("  Last Event Read = %d\n", ctx->state[id].evtReadCnt);
     }
 
   printf("--------------------------------------------------------------------------------\n");
@@ -456,20 +1259,20 @@ c775Status(int id)
 
 /*******************************************************************************
 *
-* c775PrintEvent - Print event from TDC to standard out. 
+* c775CtxPrintEvent - Print event from TDC to standard out. 
 *
 *
 * RETURNS: Number of Data words read from the TDC (including Header/Trailer).
 */
 
 int
-c775PrintEvent(int id, int pflag)
+c775CtxPrintEvent(c775_ctx * ctx, int id, int pflag)
 {
 
   int ii, nWords, evID;
   UINT32 header, trailer, dCnt;
 
-  if ((id < 0) || (c775p[id] == NULL))
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
       printf("c775ClearThresh: ERROR : TDC id %d not initialized \n", id);
       return (-1);
@@ -477,23 +1280,23 @@ c775PrintEvent(int id, int pflag)
 
   /* Check if there is a valid event */
 
-  C775LOCK;
-  if (vmeRead16(&c775p[id]->main.status2) & C775_BUFFER_EMPTY)
+  C775LOCK(id);
+  if (vmeRead16(&ctx->p[id]->main.status2) & C775_BUFFER_EMPTY)
     {
       printf("c775PrintEvent: Data Buffer is EMPTY!\n");
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (0);
     }
-  if (vmeRead16(&c775p[id]->main.status1) & C775_DATA_READY)
+  if (vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY)
     {
       dCnt = 0;
       /* Read Header - Get Word count        header = vmeRead32(&c775pl[id]->data[0]); */
-      header = vmeRead32(&c775pl[id]->data[0]);
+      header = vmeRead32(&ctx->pl[id]->data[0]);
       if ((header & C775_DATA_ID_MASK) != C775_HEADER_DATA)
 	{
 	  printf("c775PrintEvent: ERROR: Invalid Header Word 0x%08x\n",
 		 header);
-	  C775UNLOCK;
+	  C775UNLOCK(id);
 	  return (-1);
 	}
       else
@@ -507,17 +1310,17 @@ c775PrintEvent(int id, int pflag)
 	{
 	  if ((ii % 5) == 0)
 	    printf("\n    ");
-	  printf("  0x%08x", (UINT32) vmeRead32(&c775pl[id]->data[ii + 1]));
+	  printf("  0x%08x", (UINT32) vmeRead32(&ctx->pl[id]->data[ii + 1]));
 	}
       printf("\n");
       dCnt += ii;
 
-      trailer = vmeRead32(&c775pl[id]->data[dCnt]);
+      trailer = vmeRead32(&ctx->pl[id]->data[dCnt]);
       if ((trailer & C775_DATA_ID_MASK) != C775_TRAILER_DATA)
 	{
 	  printf("c775PrintEvent: ERROR: Invalid Trailer Word 0x%08x\n",
 		 trailer);
-	  C775UNLOCK;
+	  C775UNLOCK(id);
 	  return (-1);
 	}
       else
@@ -527,14 +1330,14 @@ c775PrintEvent(int id, int pflag)
 	  printf("  Trailer: 0x%08x   Event Count = %d \n", trailer, evID);
 	}
       C775_EXEC_SET_EVTREADCNT(id, evID);
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (dCnt);
 
     }
   else
     {
       printf("c775PrintEvent: Data Not ready for readout!\n");
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (0);
     }
 }
@@ -542,7 +1345,7 @@ c775PrintEvent(int id, int pflag)
 
 /*******************************************************************************
 *
-* c775ReadEvent - Read event from TDC to specified address. 
+* c775CtxReadEvent - Read event from TDC to specified address. 
 *
 *
 *
@@ -550,40 +1353,55 @@ c775PrintEvent(int id, int pflag)
 */
 
 int
-c775ReadEvent(int id, UINT32 * data)
+c775CtxReadEvent(c775_ctx * ctx, int id, UINT32 * data)
 {
 
-  int ii, nWords, evID;
+  int ii, nWords, evID, pending, ready;
   UINT32 header, trailer, dCnt;
 
-  if ((id < 0) || (c775p[id] == NULL))
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
       logMsg("c775ReadEvent: ERROR : TDC id %d not initialized \n", id, 0, 0,
 	     0, 0, 0);
       return (-1);
     }
 
-  /* Check if there is a valid event */
+  /* Check if there is a valid event.  Events counted by c775DreadyFast
+     are known to be there. */
 
-  C775LOCK;
-  if (vmeRead16(&c775p[id]->main.status2) & C775_BUFFER_EMPTY)
+  C775LOCK(id);
+  pending = C775_EVPENDING(id);
+  ready = (pending > 0);
+  if (!ready)
     {
-      logMsg("c775ReadEvent: Data Buffer is EMPTY!\n", 0, 0, 0, 0, 0, 0);
-      C775UNLOCK;
-      return (0);
+      if (vmeRead16(&ctx->p[id]->main.status2) & C775_BUFFER_EMPTY)
+	{
+	  logMsg("c775ReadEvent: Data Buffer is EMPTY!\n", 0, 0, 0, 0, 0, 0);
+	  C775UNLOCK(id);
+	  return (0);
+	}
+      ready = vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY;
     }
-  if (vmeRead16(&c775p[id]->main.status1) & C775_DATA_READY)
+  if (ready)
     {
       dCnt = 0;
       /* Read Header - Get Word count */
       /*header = c775pl[id]->data[dCnt];*/
-      header = vmeRead32(&c775pl[id]->data[dCnt]);
+      header = vmeRead32(&ctx->pl[id]->data[dCnt]);
 
+      if ((pending > 0)
+	  && ((header & C775_DATA_ID_MASK) == C775_INVALID_DATA))
+	{
+	  /* Counted event had no data (zero suppressed) */
+	  C775_EXEC_FORGET_READY(id);
+	  C775UNLOCK(id);
+	  return (0);
+	}
       if ((header & C775_DATA_ID_MASK) != C775_HEADER_DATA)
 	{
 	  logMsg("c775ReadEvent: ERROR: Invalid Header Word 0x%08x\n", header,
 		 0, 0, 0, 0, 0);
-	  C775UNLOCK;
+	  C775UNLOCK(id);
 	  return (-1);
 	}
       else
@@ -595,19 +1413,19 @@ c775ReadEvent(int id, UINT32 * data)
 	}
       for (ii = 0; ii < nWords; ii++)
 	{
-	 data[ii + 1] = vmeRead32(&c775pl[id]->data[ii + 1]);
+	 data[ii + 1] = vmeRead32(&ctx->pl[id]->data[ii + 1]);
 	  /*data[ii + 1] =         c775pl[id]->data[ii + 1];  */
 	}
       dCnt += ii;
 
       /*trailer = c775pl[id]->data[dCnt];*/
-      trailer = vmeRead32(&c775pl[id]->data[dCnt]);
+      trailer = vmeRead32(&ctx->pl[id]->data[dCnt]);
 
       if ((trailer & C775_DATA_ID_MASK) != C775_TRAILER_DATA)
 	{
 	  logMsg("c775ReadEvent: ERROR: Invalid Trailer Word 0x%08x\n",
 		 trailer, 0, 0, 0, 0, 0);
-	  C775UNLOCK;
+	  C775UNLOCK(id);
 	  return (-1);
 	}
       else
@@ -618,7 +1436,7 @@ c775ReadEvent(int id, UINT32 * data)
 	  dCnt++;
 	}
       C775_EXEC_SET_EVTREADCNT(id, evID);
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (dCnt);
 
     }
@@ -626,28 +1444,28 @@ c775ReadEvent(int id, UINT32 * data)
     {
       logMsg("c775ReadEvent: Data Not ready for readout!\n", 0, 0, 0, 0, 0,
 	     0);
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (0);
     }
 }
 
 /*******************************************************************************
 *
-* c775FlushEvent - Flush event/data from TDC. 
+* c775CtxFlushEvent - Flush event/data from TDC. 
 *
 *
 * RETURNS: Number of Data words read from the TDC.
 */
 
 int
-c775FlushEvent(int id, int fflag)
+c775CtxFlushEvent(c775_ctx * ctx, int id, int fflag)
 {
 
   int evID;
   int done = 0;
   UINT32 tmpData, dCnt;
 
-  if ((id < 0) || (c775p[id] == NULL))
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
       logMsg("c775FlushEvent: ERROR : TDC id %d not initialized \n", id, 0, 0,
 	     0, 0, 0);
@@ -656,17 +1474,18 @@ c775FlushEvent(int id, int fflag)
 
   /* Check if there is a valid event */
 
-  C775LOCK;
-  if (vmeRead16(&c775p[id]->main.status2) & C775_BUFFER_EMPTY)
+  C775LOCK(id);
+  C775_EXEC_FORGET_READY(id);
+  if (vmeRead16(&ctx->p[id]->main.status2) & C775_BUFFER_EMPTY)
     {
       if (fflag > 0)
 	logMsg("c775FlushEvent: Data Buffer is EMPTY!\n", 0, 0, 0, 0, 0, 0);
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (0);
     }
 
   /* Check if Data Ready Flag is on */
-  if (vmeRead16(&c775p[id]->main.status1) & C775_DATA_READY)
+  if (vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY)
     {
       dCnt = 0;
 
@@ -674,7 +1493,7 @@ c775FlushEvent(int id, int fflag)
 	{
 	/*trailer = vmeRead32(&c775pl[id]->data[dCnt]);
 	  tmpData = c775pl[id]->data[dCnt]; */
-	 tmpData = vmeRead32(&c775pl[id]->data[dCnt]);
+	 tmpData = vmeRead32(&ctx->pl[id]->data[dCnt]);
 
 	  switch (tmpData & C775_DATA_ID_MASK)
 	    {
@@ -716,7 +1535,7 @@ c775FlushEvent(int id, int fflag)
 	}
       if (fflag > 1)
 	printf("\n");
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (dCnt);
 
     }
@@ -725,7 +1544,7 @@ c775FlushEvent(int id, int fflag)
       if (fflag > 0)
 	logMsg("c775FlushEvent: Data Not ready for readout!\n", 0, 0, 0, 0, 0,
 	       0);
-      C775UNLOCK;
+      C775UNLOCK(id);
       return (0);
     }
 }
@@ -733,115 +1552,164 @@ c775FlushEvent(int id, int fflag)
 
 /*******************************************************************************
 *
-* c775ReadBlock - Read Block of events from TDC to specified address. 
-*
-* INPUTS:    id     - module id of TDC to access
-*            data   - address of data destination
-*            nwrds  - number of data words to transfer
+* c775DmaStart - Claim the DMA engine and start a block transfer from a VME
+*                slave into local (DMA) memory.  The source is given both as
+*                a local pointer (VxWorks) and as a VME bus address (jvme).
+* c775DmaWait  - Wait for the transfer to finish and release the engine.
 *
-* RETURNS: OK or ERROR on success of transfer.
+*    There is one DMA engine: a second c775DmaStart blocks until the
+*    transfer in flight (possibly an asynchronous one) has been waited for.
+*    c775DmaWait may be called from a different thread than c775DmaStart.
 *
-* Note: User must call c775IncrEventBlk after a successful
-*       call to c775ReadBlock to increment the number of events Read.
-*         (e.g.   c775IncrEventBlk(0,15);
+* RETURNS: c775DmaStart: OK or ERROR.
+*          c775DmaWait:  DMA status, as returned by the BSP / jvme
+*                        (VxWorks: residual bytes, Linux: bytes transfered)
 */
 
-int
-c775ReadBlock(int id, volatile UINT32 * data, int nwrds)
+LOCAL int
+c775DmaStart(volatile UINT32 * src, UINT32 vmeAdr, volatile UINT32 * data,
+	     int nwrds)
 {
+  int retVal;
 
-  int retVal, xferCount;
-  UINT32 vmeAdr, trailer, evID;
-  UINT16 stat = 0;
-
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775ReadBlock: ERROR : TDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return (-1);
-    }
+  pthread_mutex_lock(&c775DmaMutex);
+  while (c775DmaBusy)
+    pthread_cond_wait(&c775DmaCond, &c775DmaMutex);
+  c775DmaBusy = 1;
+  pthread_mutex_unlock(&c775DmaMutex);
+  c775BusCycles++;
 
-  C775LOCK;
 #ifdef VXWORKSPPC
-  /* Don't bother checking if there is a valid event. Just blast data out of the 
-     FIFO Valid or Invalid 
-     Also assume that the Universe DMA programming is setup. */
-
-  retVal =
-    sysVmeDmaSend((UINT32) data, (UINT32) (c775pl[id]->data), (nwrds << 2),
-		  0);
+  retVal = sysVmeDmaSend((UINT32) data, (UINT32) src, (nwrds << 2), 0);
+#elif defined(VXWORKS68K51)
+  /* 68K Block 32 transfer is synchronous, keep the result for the wait */
+  c775Dma68KRet = mvme_dma((long) data, 1, (long) src, 0, nwrds, 1);
+  retVal = 0;
+#else
+  retVal = vmeDmaSend((unsigned long) data, vmeAdr, (nwrds << 2));
+#endif
   if (retVal < 0)
     {
-      logMsg("c775ReadBlock: ERROR in DMA transfer Initialization 0x%x\n",
+      logMsg("c775DmaStart: ERROR in DMA transfer Initialization 0x%x\n",
 	     retVal, 0, 0, 0, 0, 0);
-      return (retVal);
+      pthread_mutex_lock(&c775DmaMutex);
+      c775DmaBusy = 0;
+      pthread_cond_broadcast(&c775DmaCond);
+      pthread_mutex_unlock(&c775DmaMutex);
+      return (ERROR);
     }
-  /* Wait until Done or Error */
-  retVal = sysVmeDmaDone(1000, 1);
 
-#elif defined(VXWORKS68K51)
+  return (OK);
+}
 
-  /* 68K Block 32 transfer from FIFO using VME2Chip */
-  retVal = mvme_dma((long) data, 1, (long) (c775pl[id]->data), 0, nwrds, 1);
+LOCAL int
+c775DmaWait(void)
+{
+  int retVal;
 
+#ifdef VXWORKSPPC
+  retVal = sysVmeDmaDone(1000, 1);
+#elif defined(VXWORKS68K51)
+  retVal = c775Dma68KRet;
 #else
-  /* Linux readout with jvme library */
-  vmeAdr = (UINT32) (c775p[id]->data) - c775MemOffset;
-  retVal = vmeDmaSend((UINT32) data, vmeAdr, (nwrds << 2));
+  retVal = vmeDmaDone();
+#endif
+
+  pthread_mutex_lock(&c775DmaMutex);
+  c775DmaBusy = 0;
+  pthread_cond_broadcast(&c775DmaCond);
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  return (retVal);
+}
+
+/*******************************************************************************
+*
+* c775DmaXfer - Synchronous block transfer from a VME slave into local (DMA)
+*               memory.
+*
+* RETURNS: Number of longwords transfered, or ERROR.
+*/
+
+LOCAL int
+c775DmaXfer(volatile UINT32 * src, UINT32 vmeAdr, volatile UINT32 * data,
+	    int nwrds)
+{
+  int retVal;
+
+  if (c775DmaStart(src, vmeAdr, data, nwrds) != OK)
+    return (ERROR);
+
+  retVal = c775DmaWait();
   if (retVal < 0)
     {
-      logMsg("c775ReadBlock: ERROR in DMA transfer Initialization 0x%x\n",
-	     retVal, 0, 0, 0, 0, 0);
-      C775UNLOCK;
+      logMsg("c775DmaXfer: ERROR in DMA transfer 0x%x\n", retVal, 0, 0, 0,
+	     0, 0);
       return (ERROR);
     }
-  /* Wait until Done or Error */
-  retVal = vmeDmaDone();
 
+#ifdef VXWORKS
+  return (nwrds - (retVal >> 2));	/* retVal is the residual byte count */
+#else
+  return (retVal >> 2);
 #endif
+}
+
+/*******************************************************************************
+*
+* c775ReadBlockDone - Check the result of a c775ReadBlock style transfer:
+*                     Bus Error termination by the TDC and the trailer of
+*                     the last event.  TDC must be locked by the caller.
+*
+* RETURNS: Number of data words transfered, OK (nothing) or ERROR.
+*/
+
+LOCAL int
+c775ReadBlockDone(c775_ctx * ctx, int id, volatile UINT32 * data, int nwrds,
+		  int retVal)
+{
+  int xferCount;
+  UINT32 trailer, evID;
+  UINT16 stat = 0;
+
+  /* A block read takes an unknown number of events */
+  C775_EXEC_FORGET_READY(id);
 
   if (retVal != 0)
     {
       /* Check to see if error was generated by TDC */
-      stat = vmeRead16(&c775p[id]->main.bitSet1) & C775_VME_BUS_ERROR;
+      stat = vmeRead16(&ctx->p[id]->main.bitSet1) & C775_VME_BUS_ERROR;
       if ((retVal > 0) && (stat))
 	{
-	  vmeWrite16(&c775p[id]->main.bitClear1, C775_VME_BUS_ERROR);
+	  vmeWrite16(&ctx->p[id]->main.bitClear1, C775_VME_BUS_ERROR);
 /*       logMsg("c775ReadBlock: INFO: DMA terminated by TDC(BUS Error) - Transfer OK\n",0,0,0,0,0,0); */
 #ifdef VXWORKS
 	  xferCount = (nwrds - (retVal >> 2));	/* Number of Longwords transfered */
 #else
 	  xferCount = (retVal >> 2);	/* Number of Longwords transfered */
+	  if (c775BlockSwap)
+	    c775SwapBlock(data, xferCount);
 #endif
-	  trailer = data[xferCount - 1];
-#ifndef VXWORKS
-	  trailer = LSWAP(trailer);   /*   zzzzzzzzzzz  */
-#endif
+	  trailer = C775_DMA_WORD(data[xferCount - 1]);
 	  if ((trailer & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
 	    {
 	      evID = trailer & C775_EVENTCOUNT_MASK;
 	      C775_EXEC_SET_EVTREADCNT(id, evID);
-	      C775UNLOCK;
 	      return (xferCount);	/* Return number of data words transfered */
 	    }
 	  else
 	    {
-	      trailer = data[xferCount - 2];
-#ifndef VXWORKS
-	      trailer = LSWAP(trailer);   /*   zzzzzzzzzzz  */
-#endif
+	      trailer = C775_DMA_WORD(data[xferCount - 2]);
 	      if ((trailer & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
 		{
 		  evID = trailer & C775_EVENTCOUNT_MASK;
 		  C775_EXEC_SET_EVTREADCNT(id, evID);
-		  C775UNLOCK;
 		  return (xferCount - 1);	/* Return number of data words transfered */
 		}
 	      else
 		{
 		  logMsg("c775ReadBlock: ERROR: Invalid Trailer data 0x%x\n",
 			 trailer, 0, 0, 0, 0, 0);
-		  C775UNLOCK;
 		  return (xferCount);
 		}
 	    }
@@ -850,806 +1718,4266 @@ c775ReadBlock(int id, volatile UINT32 * data, int nwrds)
 	{
 	  logMsg("c775ReadBlock: ERROR in DMA transfer 0x%x\n", retVal, 0, 0,
 		 0, 0, 0);
-	  C775UNLOCK;
 	  return (retVal);
 	}
     }
 
-  C775UNLOCK;
   return (OK);
-
 }
 
-
 /*******************************************************************************
 *
-* c775Int - default interrupt handler
+* c775CtxReadBlock - Read Block of events from TDC to specified address. 
 *
-* This rountine handles the c775 TDC interrupt.  A user routine is
-* called, if one was connected by c775IntConnect().
+* INPUTS:    id     - module id of TDC to access
+*            data   - address of data destination
+*            nwrds  - number of data words to transfer
 *
-* RETURNS: N/A
+* RETURNS: OK or ERROR on success of transfer.
 *
+* Note: User must call c775IncrEventBlk after a successful
+*       call to c775ReadBlock to increment the number of events Read.
+*         (e.g.   c775IncrEventBlk(0,15);
+*       Data is left in VME (big endian) byte order, unless
+*       c775SetBlockSwap(1).
 */
-//FIXME SKIPPED
-LOCAL void
-c775Int(void)
-{
-  int ii = 0;
-  UINT32 nevt = 0;
-
-  /* Disable interrupts */
-#ifdef VXWORKS
-  sysIntDisable(c775IntLevel);
-#endif
 
-  c775IntCount++;
+int
+c775CtxReadBlock(c775_ctx * ctx, int id, volatile UINT32 * data, int nwrds)
+{
 
-#ifndef VXWORKS
-  vmeBusLock();
-#endif
+  int retVal;
+  UINT32 vmeAdr;
 
-  if (c775IntRoutine != NULL)
-    {				/* call user routine */
-      (*c775IntRoutine) (c775IntArg);
-    }
-  else
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
-      if ((c775IntID < 0) || (c775p[c775IntID] == NULL))
-	{
-	  logMsg("c775Int: ERROR : TDC id %d not initialized \n", c775IntID,
-		 0, 0, 0, 0, 0);
-	  return;
-	}
-      /* Default action is to increment the Read pointer by
-         the number of events in the Event Trigger register
-         or until the Data buffer is empty. The later case would
-         indicate a possible error. In either case the data is
-         effectively thrown away */
-      C775LOCK;
-      nevt = vmeRead16(&c775p[c775IntID]->main.evTrigger) & C775_EVTRIGGER_MASK;
-      C775UNLOCK;
-      while ((ii < nevt) && (c775Dready(c775IntID) > 0))
-	{
-	  C775LOCK;
-	  C775_EXEC_INCR_EVENT(c775IntID);
-	  C775UNLOCK;
-	  ii++;
-	}
-      if (ii < nevt)
-	logMsg
-	  ("c775Int: WARN : TDC %d - Events dumped (%d) != Events Triggered (%d)\n",
-	   c775IntID, ii, nevt, 0, 0, 0);
-      logMsg("c775Int: Processed %d events\n", nevt, 0, 0, 0, 0, 0);
-
+      logMsg("c775ReadBlock: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return (-1);
     }
 
-  /* Enable interrupts */
-#ifdef VXWORKS
-  sysIntEnable(c775IntLevel);
-#else
-  vmeBusUnlock();
-#endif
+  C775LOCK(id);
+  /* Don't bother checking if there is a valid event. Just blast data out of the 
+     FIFO Valid or Invalid */
+  vmeAdr = (UINT32) ((unsigned long) (ctx->p[id]->data) - ctx->memOffset);
+  if (c775DmaStart(ctx->pl[id]->data, vmeAdr, data, nwrds) != OK)
+    {
+      C775UNLOCK(id);
+      return (ERROR);
+    }
+  /* Wait until Done or Error */
+  retVal = c775DmaWait();
 
+  retVal = c775ReadBlockDone(ctx, id, data, nwrds, retVal);
+  C775UNLOCK(id);
 
+  return (retVal);
 }
 
+/*******************************************************************************
+*
+* c775AsyncThread - Completion thread for asynchronous block reads.
+*                   Waits on the DMA engine so the caller does not have to.
+*
+*/
+
+LOCAL void *
+c775AsyncThread(void *arg)
+{
+  int retVal;
+
+  pthread_mutex_lock(&c775DmaMutex);
+  while (1)
+    {
+      while (c775Async.state != C775_ASYNC_STARTED)
+	pthread_cond_wait(&c775DmaCond, &c775DmaMutex);
+      pthread_mutex_unlock(&c775DmaMutex);
+
+      retVal = c775DmaWait();
+
+      pthread_mutex_lock(&c775DmaMutex);
+      c775Async.retVal = retVal;
+      c775Async.state = C775_ASYNC_DONE;
+      pthread_cond_broadcast(&c775DmaCond);
+    }
+
+  return (NULL);
+}
 
 /*******************************************************************************
 *
-* c775IntConnect - connect a user routine to the c775 TDC interrupt
+* c775ReadBlockBufInit - Set the rotating destination buffers for
+*                        asynchronous block reads.
 *
-* This routine specifies the user interrupt routine to be called at each
-* interrupt. 
+* INPUTS:    nbufs    - number of buffers (2 - C775_MAX_DMA_BUFS)
+*            bufs     - buffer addresses (DMA memory)
+*            bufwords - size of each buffer in longwords
 *
-* RETURNS: OK, or ERROR if Interrupts are enabled
+* RETURNS: OK, or ERROR.
 */
-//FIXME SKIPPED
 
 STATUS
-c775IntConnect(VOIDFUNCPTR routine, int arg, UINT16 level, UINT16 vector)
+c775ReadBlockBufInit(int nbufs, volatile UINT32 ** bufs, int bufwords)
 {
+  int ii;
 
-  if (c775IntRunning)
+  if ((nbufs < 2) || (nbufs > C775_MAX_DMA_BUFS))
     {
-      printf
-	("c775IntConnect: ERROR : Interrupts already Initialized for TDC id %d\n",
-	 c775IntID);
+      printf("c775ReadBlockBufInit: ERROR: Number of buffers (%d) out of range (2-%d)\n",
+	     nbufs, C775_MAX_DMA_BUFS);
       return (ERROR);
     }
 
-  c775IntRoutine = routine;
-  c775IntArg = arg;
-
-  /* Check for user defined VME interrupt level and vector */
-  if (level == 0)
-    {
-      c775IntLevel = C775_VME_INT_LEVEL;	/* use default */
-    }
-  else if (level > 7)
+  pthread_mutex_lock(&c775DmaMutex);
+  if (c775Async.state != C775_ASYNC_IDLE)
     {
-      printf
-	("c775IntConnect: ERROR: Invalid VME interrupt level (%d). Must be (1-7)\n",
-	 level);
+      pthread_mutex_unlock(&c775DmaMutex);
+      printf("c775ReadBlockBufInit: ERROR: Block read in progress\n");
       return (ERROR);
     }
-  else
+
+  for (ii = 0; ii < nbufs; ii++)
     {
-      c775IntLevel = level;
+      c775Async.buf[ii] = bufs[ii];
+      c775Async.bufState[ii] = 0;
     }
+  c775Async.nbufs = nbufs;
+  c775Async.bufwords = bufwords;
+  c775Async.next = 0;
 
-  if (vector == 0)
+  if (!c775Async.threadRunning)
     {
-      c775IntVec = C775_INT_VEC;	/* use default */
+      if (pthread_create(&c775Async.thread, NULL, c775AsyncThread, NULL) != 0)
+	{
+	  pthread_mutex_unlock(&c775DmaMutex);
+	  perror("c775ReadBlockBufInit: pthread_create");
+	  return (ERROR);
+	}
+      pthread_detach(c775Async.thread);
+      c775Async.threadRunning = 1;
     }
-  else if ((vector < 32) || (vector > 255))
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxReadBlockStart - Start a block read from TDC into the next free
+*                        buffer and return without waiting.
+* c775ReadBlockPoll    - Check if the block read has completed.
+* c775ReadBlockWait    - Wait for the block read to complete and check
+*                        Bus Error and trailer as c775ReadBlock does.
+* c775ReadBlockRelease - Give a buffer back for reuse.
+*
+*    Only one block read can be in flight (one DMA engine), but with two
+*    or more buffers the data of block N can be processed while block N+1
+*    is on the bus:
+*
+*        c775ReadBlockStart(id, nwrds);
+*        while (running) {
+*          nw = c775ReadBlockWait(&data);
+*          c775ReadBlockStart(id, nwrds);
+*          ... process nw words of data ...
+*          c775ReadBlockRelease(data);
+*        }
+*
+*    The TDC stays locked from c775ReadBlockStart until c775ReadBlockWait
+*    has collected the transfer, so no other reader can take words out
+*    of its output buffer while the DMA is on the bus.  Call both from the
+*    same thread, and do not call other functions on that TDC in between.
+*
+* RETURNS: c775ReadBlockStart:   buffer number, or ERROR
+*          c775ReadBlockPoll:    1 if done, 0 if still busy, ERROR if idle
+*          c775ReadBlockWait:    as c775ReadBlock, *data is set to the buffer
+*          c775ReadBlockRelease: OK, or ERROR
+*
+* Note: As with c775ReadBlock, the user must call c775IncrEventBlk.
+*/
+
+int
+c775CtxReadBlockStart(c775_ctx * ctx, int id, int nwrds)
+{
+  int ibuf;
+  UINT32 vmeAdr;
+  volatile UINT32 *data;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
-      printf
-	("c775IntConnect: ERROR: Invalid interrupt vector (%d). Must be (32<vector<255)\n",
-	 vector);
+      logMsg("c775ReadBlockStart: ERROR : TDC id %d not initialized \n", id,
+	     0, 0, 0, 0, 0);
       return (ERROR);
     }
-  else
-    {
-      c775IntVec = vector;
-    }
 
-  /* Connect the ISR */
-#ifdef VXWORKSPPC
-  if ((intDisconnect((int) INUM_TO_IVEC(c775IntVec)) != 0))
+  pthread_mutex_lock(&c775DmaMutex);
+  if (c775Async.nbufs == 0)
     {
-      printf("c775IntConnect: ERROR disconnecting Interrupt\n");
+      pthread_mutex_unlock(&c775DmaMutex);
+      logMsg("c775ReadBlockStart: ERROR : Buffers not initialized\n", 0, 0, 0,
+	     0, 0, 0);
       return (ERROR);
     }
-#endif
-#ifdef VXWORKS
-  if ((intConnect(INUM_TO_IVEC(c775IntVec), c775Int, 0)) != 0)
+  if (c775Async.state != C775_ASYNC_IDLE)
     {
-      printf("c775IntConnect: ERROR in intConnect()\n");
+      pthread_mutex_unlock(&c775DmaMutex);
+      logMsg("c775ReadBlockStart: ERROR : Block read already in progress\n",
+	     0, 0, 0, 0, 0, 0);
       return (ERROR);
     }
-#else
-  if (vmeIntDisconnect(c775IntLevel) != 0)
+  ibuf = c775Async.next;
+  if (c775Async.bufState[ibuf])
     {
-      printf("c775IntConnect: ERROR disconnecting Interrupt\n");
+      pthread_mutex_unlock(&c775DmaMutex);
+      logMsg("c775ReadBlockStart: ERROR : Buffer %d not released\n", ibuf, 0,
+	     0, 0, 0, 0);
       return (ERROR);
     }
-  if (vmeIntConnect(c775IntVec, c775IntLevel, c775Int, 0) != 0)
+  if (nwrds > c775Async.bufwords)
+    nwrds = c775Async.bufwords;
+  c775Async.bufState[ibuf] = 1;
+  c775Async.next = (ibuf + 1) % c775Async.nbufs;
+  c775Async.state = C775_ASYNC_PENDING;
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  data = c775Async.buf[ibuf];
+  C775LOCK(id);			/* Released by c775ReadBlockWait */
+  vmeAdr = (UINT32) ((unsigned long) (ctx->p[id]->data) - ctx->memOffset);
+  if (c775DmaStart(ctx->pl[id]->data, vmeAdr, data, nwrds) != OK)
     {
-      printf("c775IntConnect: ERROR in intConnect()\n");
+      C775UNLOCK(id);
+      pthread_mutex_lock(&c775DmaMutex);
+      c775Async.bufState[ibuf] = 0;
+      c775Async.next = ibuf;
+      c775Async.state = C775_ASYNC_IDLE;
+      pthread_mutex_unlock(&c775DmaMutex);
       return (ERROR);
     }
-#endif
 
-  return (OK);
+  /* Hand the wait over to the completion thread */
+  pthread_mutex_lock(&c775DmaMutex);
+  c775Async.ctx = ctx;
+  c775Async.id = id;
+  c775Async.ibuf = ibuf;
+  c775Async.nwrds = nwrds;
+  c775Async.state = C775_ASYNC_STARTED;
+  pthread_cond_broadcast(&c775DmaCond);
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  return (ibuf);
+}
+
+int
+c775ReadBlockPoll(void)
+{
+  int rval;
+
+  pthread_mutex_lock(&c775DmaMutex);
+  if (c775Async.state == C775_ASYNC_IDLE)
+    rval = ERROR;
+  else
+    rval = (c775Async.state == C775_ASYNC_DONE) ? 1 : 0;
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  return (rval);
+}
+
+int
+c775ReadBlockWait(volatile UINT32 ** data)
+{
+  c775_ctx *ctx;
+  int id, ibuf, nwrds, retVal;
+
+  pthread_mutex_lock(&c775DmaMutex);
+  if (c775Async.state == C775_ASYNC_IDLE)
+    {
+      pthread_mutex_unlock(&c775DmaMutex);
+      logMsg("c775ReadBlockWait: ERROR : No block read in progress\n", 0, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+  while (c775Async.state != C775_ASYNC_DONE)
+    pthread_cond_wait(&c775DmaCond, &c775DmaMutex);
+  ctx = c775Async.ctx;
+  id = c775Async.id;
+  ibuf = c775Async.ibuf;
+  nwrds = c775Async.nwrds;
+  retVal = c775Async.retVal;
+  c775Async.state = C775_ASYNC_IDLE;
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  *data = c775Async.buf[ibuf];
+
+  /* The TDC was locked by c775ReadBlockStart */
+  retVal = c775ReadBlockDone(ctx, id, *data, nwrds, retVal);
+  C775UNLOCK(id);
+
+  return (retVal);
 }
 
+STATUS
+c775ReadBlockRelease(volatile UINT32 * data)
+{
+  int ii;
+
+  pthread_mutex_lock(&c775DmaMutex);
+  for (ii = 0; ii < c775Async.nbufs; ii++)
+    {
+      if (c775Async.buf[ii] == data)
+	{
+	  c775Async.bufState[ii] = 0;
+	  pthread_mutex_unlock(&c775DmaMutex);
+	  return (OK);
+	}
+    }
+  pthread_mutex_unlock(&c775DmaMutex);
+
+  logMsg("c775ReadBlockRelease: ERROR : 0x%lx is not a block read buffer\n",
+	 (unsigned long) data, 0, 0, 0, 0, 0);
+  return (ERROR);
+}
 
 /*******************************************************************************
 *
-* c775IntEnable - Enable interrupts from specified TDC
+* c775DmaFifo - Block transfer from the TDC output buffer, terminated by
+*               the TDC Bus Error when the buffer runs empty.
+*               TDC must be locked by the caller.
 *
-* Enables interrupts for a specified TDC.
-* 
-* RETURNS OK or ERROR if TDC is not available or parameter is out of range
+* RETURNS: Number of longwords transfered, or ERROR.
 */
 
-STATUS
-c775IntEnable(int id, UINT16 evCnt)
+LOCAL int
+c775DmaFifo(c775_ctx * ctx, int id, volatile UINT32 * data, int nwrds)
 {
+  int xferCount;
+
+  xferCount = c775DmaXfer(ctx->pl[id]->data,
+			  (UINT32) ((unsigned long) (ctx->p[id]->data) - ctx->memOffset),
+			  data, nwrds);
+  if ((xferCount <= 0) || (xferCount == nwrds))
+    return (xferCount);
 
-  if (c775IntRunning)
+  /* A short transfer must have been ended by the TDC */
+  if (vmeRead16(&ctx->p[id]->main.bitSet1) & C775_VME_BUS_ERROR)
     {
-      printf
-	("c775IntEnable: ERROR : Interrupts already initialized for TDC id %d\n",
-	 c775IntID);
-      return (ERROR);
+      vmeWrite16(&ctx->p[id]->main.bitClear1, C775_VME_BUS_ERROR);
+      return (xferCount);
     }
 
-  if ((id < 0) || (c775p[id] == NULL))
+  logMsg("c775DmaFifo: ERROR: DMA terminated by unknown Bus Error\n", 0, 0,
+	 0, 0, 0, 0);
+  return (ERROR);
+}
+
+/*******************************************************************************
+*
+* c775CtxReadEvents - Drain all events from the TDC output buffer with a single
+*                  Bus Error terminated DMA and index the event boundaries.
+*
+* INPUTS:    id       - module id of TDC to access
+*            data     - address of data destination (DMA memory)
+*            maxwords - size of data in longwords
+*                       (C775_MAX_BLOCK_WORDS drains a full buffer)
+*            index    - filled with the header position of every complete
+*                       event, the words transfered and the new read count
+*
+* RETURNS: Number of complete events read, 0 if the buffer is empty,
+*          or ERROR.
+*
+* Note: Bus Error must be enabled (c775EnableBerr) so the TDC ends the
+*       transfer when its buffer is empty.  The Event Read Count is updated
+*       from the last trailer, so c775IncrEventBlk must NOT be called.
+*       With maxwords less than the TDC holds, the event cut off at the
+*       end is lost; the next call skips its remaining words, up to the
+*       next header (offset[0] is then past them).
+*       Data is left in VME (big endian) byte order, unless
+*       c775SetBlockSwap(1).
+*/
+
+int
+c775CtxReadEvents(c775_ctx * ctx, int id, volatile UINT32 * data, int maxwords,
+		  c775_evindex * index)
+{
+  int ii, end = 0, nWords, nevts = 0, nskip = 0, xferCount;
+  UINT32 header, trailer, evID = 0, haveID = 0;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
     {
-      printf("c775IntEnable: ERROR : TDC id %d not initialized \n", id);
+      logMsg("c775ReadEvents: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
       return (ERROR);
     }
-  else
+
+  index->nevents = 0;
+  index->nwords = 0;
+  index->offset[0] = 0;
+
+  if (maxwords > C775_MAX_BLOCK_WORDS)
+    maxwords = C775_MAX_BLOCK_WORDS;
+
+  C775LOCK(id);
+  index->readCount = ctx->state[id].evtReadCnt;
+
+  /* Skip the DMA setup entirely when there is nothing to move.  Events
+     counted by c775DreadyFast are known to be there. */
+  if ((C775_EVPENDING(id) <= 0)
+      && !(vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY))
     {
-      c775IntID = id;
+      C775UNLOCK(id);
+      return (0);
     }
 
-  /* check for event count out of range */
-  if ((evCnt <= 0) || (evCnt > 31))
+  xferCount = c775DmaFifo(ctx, id, data, maxwords);
+  if (xferCount < 0)
     {
-      printf
-	("c775IntEnable: ERROR: Event count %d for Interrupt is out of range (1-31)\n",
-	 evCnt);
+      C775UNLOCK(id);
       return (ERROR);
     }
-
-#ifdef VXWORKS
-  sysIntEnable(c775IntLevel);	/* Enable VME interrupts */
+#ifndef VXWORKS
+  if (c775BlockSwap)
+    c775SwapBlock(data, xferCount);
 #endif
 
-  /* Zero Counter and set Running Flag */
-  c775IntEvCount = evCnt;
-  c775IntCount = 0;
-  c775IntRunning = TRUE;
-  /* Enable interrupts on TDC */
-  C775LOCK;
-  vmeWrite16(&c775p[c775IntID]->main.intVector, c775IntVec);
-  vmeWrite16(&c775p[c775IntID]->main.intLevel, c775IntLevel);
-  vmeWrite16(&c775p[c775IntID]->main.evTrigger, c775IntEvCount);
-  C775UNLOCK;
+  /* Walk the headers: each event is header + nWords + trailer */
+  ii = 0;
+  while (ii < xferCount)
+    {
+      header = C775_DMA_WORD(data[ii]);
+      if ((header & C775_DATA_ID_MASK) == C775_INVALID_DATA)
+	break;			/* Filler or Invalid data ends the block */
+      if ((header & C775_DATA_ID_MASK) != C775_HEADER_DATA)
+	{
+	  /* Rest of an event cut off by the previous read: resync on the
+	     next header, its trailer still counts as read */
+	  if ((header & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
+	    {
+	      evID = header & C775_EVENTCOUNT_MASK;
+	      haveID = 1;
+	    }
+	  nskip++;
+	  ii++;
+	  continue;
+	}
+
+      nWords = (header & C775_WORDCOUNT_MASK) >> 8;
+      if ((ii + nWords + 1) >= xferCount)
+	{
+	  /* Cut off by maxwords: the next call skips the rest of it.
+	     Otherwise the TDC ended the transfer inside an event. */
+	  if (xferCount < maxwords)
+	    logMsg("c775ReadEvents: ERROR: Truncated event at word %d (%d"
+		   " words read)\n", ii, xferCount, 0, 0, 0, 0);
+	  break;
+	}
 
-  return (OK);
+      trailer = C775_DMA_WORD(data[ii + nWords + 1]);
+      if ((trailer & C775_DATA_ID_MASK) != C775_TRAILER_DATA)
+	{
+	  logMsg("c775ReadEvents: ERROR: Invalid Trailer data 0x%x\n",
+		 trailer, 0, 0, 0, 0, 0);
+	  break;
+	}
+
+      index->offset[nevts++] = ii;
+      evID = trailer & C775_EVENTCOUNT_MASK;
+      haveID = 1;
+      ii += nWords + 2;
+      end = ii;
+    }
+
+  if (nskip > 0)
+    logMsg("c775ReadEvents: WARN: TDC %d: %d words outside of an event"
+	   " skipped\n", id, nskip, 0, 0, 0, 0);
+  if (haveID)
+    C775_EXEC_SET_EVTREADCNT(id, evID);
+  if (xferCount < maxwords)
+    C775_EXEC_FORGET_READY(id);	/* Buffer drained */
+
+  index->nevents = nevts;
+  index->nwords = xferCount;
+  index->offset[nevts] = (nevts > 0) ? end : ii;
+  index->readCount = ctx->state[id].evtReadCnt;
+  C775UNLOCK(id);
+
+  return (nevts);
 }
 
 
 /*******************************************************************************
 *
-* c775IntDisable - disable the TDC interrupts
+* c775CtxCBLTInit - Program every initialized TDC for Chained Block Transfer.
 *
-* RETURNS: OK, or ERROR if not initialized
+*    The TDCs must sit in adjacent slots, in order of their id: id 0 is
+*    programmed as the first board of the chain, id Nc775-1 as the last.
+*    Bus Error is enabled on every board, the last one ends the chain.
+*
+* INPUTS:    addr  - A32 address of the chain (0xXX000000, only the upper
+*                    8 bits are used).  This is also the Multicast (MCST)
+*                    address used by c775ClearAll() etc.
+*
+* RETURNS: OK, or ERROR.
+*
+* Note: The DMA must be configured for A32 (e.g. vmeDmaConfig(2,3,0)) for
+*       the chained readout with c775ReadCBLT.
 */
 
 STATUS
-c775IntDisable(int iflag)
+c775CtxCBLTInit(c775_ctx * ctx, UINT32 addr)
 {
+  int ii, res, geo;
+  unsigned long laddr;
+  UINT16 ctrl;
 
-  if ((c775IntID < 0) || (c775p[c775IntID] == NULL))
+  if (ctx->nboards < 2)
     {
-      logMsg("c775IntDisable: ERROR : TDC id %d not initialized \n",
-	     c775IntID, 0, 0, 0, 0, 0);
+      printf("c775CBLTInit: ERROR: CBLT requires at least 2 TDCs (%d initialized)\n",
+	     ctx->nboards);
+      return (ERROR);
+    }
+  if (ctx->nboards > C775_MAX_BOARDS)
+    {
+      printf("c775CBLTInit: ERROR: At most %d TDCs in a chain (%d initialized)\n",
+	     C775_MAX_BOARDS, ctx->nboards);
+      return (ERROR);
+    }
+
+  if ((addr & 0x00ffffff) != 0)
+    {
+      printf("c775CBLTInit: ERROR: Invalid CBLT address 0x%08x (must be 0xXX000000)\n",
+	     addr);
       return (ERROR);
     }
 
 #ifdef VXWORKS
-  sysIntDisable(c775IntLevel);	/* Disable VME interrupts */
+  res = sysBusToLocalAdrs(0x09, (char *) addr, (char **) &laddr);
+#else
+  res = vmeBusToLocalAdrs(0x09, (char *) (unsigned long) addr,
+			  (char **) &laddr);
 #endif
-  C775LOCK;
-  vmeWrite16(&c775p[c775IntID]->main.evTrigger, 0);
-
-  /* Tell tasks that Interrupts have been disabled */
-  if (iflag > 0)
+  if (res != 0)
     {
-      c775IntRunning = FALSE;
-      vmeWrite16(&c775p[c775IntID]->main.intLevel, 0);
-      vmeWrite16(&c775p[c775IntID]->main.intVector, 0);
+      printf("c775CBLTInit: ERROR in BusToLocalAdrs(0x09,0x%x,&laddr) \n",
+	     addr);
+      return (ERROR);
     }
-#ifdef VXWORKS
-  else
+
+  for (ii = 0; ii < 32; ii++)
+    ctx->geoID[ii] = -1;
+
+  C775LOCK_ALL;
+  for (ii = 0; ii < ctx->nboards; ii++)
     {
-      semGive(c775Sem);
+      geo = vmeRead16(&ctx->p[ii]->main.geoAddr) & 0x1f;
+      if (ctx->geoID[geo] != -1)
+	{
+	  printf("c775CBLTInit: ERROR: TDC %d and %d both have GEO address %d\n",
+		 ctx->geoID[geo], ii, geo);
+	  C775UNLOCK_ALL;
+	  return (ERROR);
+	}
+      ctx->geo[ii] = geo;
+      ctx->geoID[geo] = ii;
+
+      if (ii == 0)
+	ctrl = C775_CBLT_FIRST;
+      else if (ii == (ctx->nboards - 1))
+	ctrl = C775_CBLT_LAST;
+      else
+	ctrl = C775_CBLT_MIDDLE;
+
+      C775_WRITE(ii, cbltAddr, (addr >> 24) & 0xff);
+      C775_WRITE(ii, cbltControl, ctrl);
+      C775_WRITE(ii, control1, C775_BERR_ENABLE);
     }
-#endif
+  ctx->cbltAdr = addr;
+  ctx->cbltp = (c775_regs *) laddr;
+  C775UNLOCK_ALL;
+
+  printf("c775CBLTInit: %d TDCs chained at VME (LOCAL) address 0x%08x (0x%lx)\n",
+	 ctx->nboards, addr, laddr);
 
-  C775UNLOCK;
   return (OK);
 }
 
 /*******************************************************************************
 *
-* c775IntResume - Re-enable interrupts from previously 
-*                 intitialized TDC
+* c775CtxCBLTDisable - Take all TDCs out of the CBLT chain
 *
-* RETURNS: OK, or ERROR if not initialized
+* RETURNS: None.
 */
 
-STATUS
-c775IntResume(void)
+void
+c775CtxCBLTDisable(c775_ctx * ctx)
 {
-  UINT16 evTrig = 0;
+  int ii;
+
+  C775LOCK_ALL;
+  for (ii = 0; ii < ctx->nboards; ii++)
+    C775_WRITE(ii, cbltControl, 0);
+  ctx->cbltAdr = 0;
+  ctx->cbltp = NULL;
+  C775UNLOCK_ALL;
+}
+
+/*******************************************************************************
+*
+* c775CtxReadCBLT - Read all TDCs in the crate with one Chained Block Transfer
+*                and split the result by board (GEO address).
+*
+* INPUTS:    data     - address of data destination (DMA memory)
+*            maxwords - size of data in longwords
+*                       (Nc775*C775_MAX_BLOCK_WORDS drains every buffer)
+*            index    - filled with the offset, length and number of events
+*                       of each TDC's data, indexed by TDC id
+*
+* RETURNS: Number of longwords transfered, or ERROR.
+*
+* Note: The Event Read Count of every TDC is updated from its last trailer.
+*       Data is left in VME (big endian) byte order, unless
+*       c775SetBlockSwap(1).
+*/
+
+int
+c775CtxReadCBLT(c775_ctx * ctx, volatile UINT32 * data, int maxwords,
+		c775_cbltindex * index)
+{
+  int ii, id, geo, nWords, xferCount;
+  UINT32 header, trailer, evID[C775_MAX_BOARDS];
 
-  if ((c775IntID < 0) || (c775p[c775IntID] == NULL))
+  if (ctx->cbltp == NULL)
     {
-      logMsg("c775IntResume: ERROR : TDC id %d not initialized \n", c775IntID,
-	     0, 0, 0, 0, 0);
+      logMsg("c775ReadCBLT: ERROR : CBLT not initialized\n", 0, 0, 0, 0, 0,
+	     0);
       return (ERROR);
     }
 
-  C775LOCK;
-  if ((c775IntRunning))
+  index->nwords = 0;
+  for (id = 0; id < ctx->nboards; id++)
     {
-      evTrig = vmeRead16(&c775p[c775IntID]->main.evTrigger) & C775_EVTRIGGER_MASK;
-      if (evTrig == 0)
-	{
-#ifdef VXWORKS
-	  sysIntEnable(c775IntLevel);
+      index->offset[id] = 0;
+      index->nwrds[id] = 0;
+      index->nevents[id] = 0;
+    }
+
+  C775LOCK_ALL;
+  xferCount = c775DmaXfer(ctx->cbltp->data, ctx->cbltAdr, data, maxwords);
+  if (xferCount < 0)
+    {
+      C775UNLOCK_ALL;
+      return (ERROR);
+    }
+#ifndef VXWORKS
+  if (c775BlockSwap)
+    c775SwapBlock(data, xferCount);
 #endif
-	  vmeWrite16(&c775p[c775IntID]->main.evTrigger, c775IntEvCount);
+
+  /* The last board in the chain ends the transfer with a Bus Error */
+  if (vmeRead16(&ctx->p[ctx->nboards - 1]->main.bitSet1) & C775_VME_BUS_ERROR)
+    vmeWrite16(&ctx->p[ctx->nboards - 1]->main.bitClear1, C775_VME_BUS_ERROR);
+  else if (xferCount == maxwords)
+    logMsg("c775ReadCBLT: WARN: Buffer full (%d words), chain not drained\n",
+	   maxwords, 0, 0, 0, 0, 0);
+
+  /* Each board's events are contiguous, in chain order */
+  ii = 0;
+  while (ii < xferCount)
+    {
+      header = C775_DMA_WORD(data[ii]);
+      if ((header & C775_DATA_ID_MASK) != C775_HEADER_DATA)
+	break;
+
+      geo = (header & C775_GEO_ADDR_MASK) >> 27;
+      id = ctx->geoID[geo];
+      nWords = (header & C775_WORDCOUNT_MASK) >> 8;
+      if ((id < 0) || ((ii + nWords + 1) >= xferCount))
+	{
+	  logMsg("c775ReadCBLT: ERROR: Bad event (GEO %d) at word %d\n", geo,
+		 ii, 0, 0, 0, 0);
+	  break;
 	}
-      else
+
+      trailer = C775_DMA_WORD(data[ii + nWords + 1]);
+      if ((trailer & C775_DATA_ID_MASK) != C775_TRAILER_DATA)
 	{
-	  logMsg("c775IntResume: WARNING : Interrupts already enabled \n", 0,
+	  logMsg("c775ReadCBLT: ERROR: Invalid Trailer data 0x%x\n", trailer,
 		 0, 0, 0, 0, 0);
-	  C775UNLOCK;
-	  return (ERROR);
+	  break;
 	}
+
+      if (index->nevents[id] == 0)
+	index->offset[id] = ii;
+      index->nevents[id]++;
+      index->nwrds[id] += nWords + 2;
+      evID[id] = trailer & C775_EVENTCOUNT_MASK;
+      ii += nWords + 2;
     }
-  else
+
+  for (id = 0; id < ctx->nboards; id++)
     {
-      logMsg("c775IntResume: ERROR : Interrupts are not Enabled \n", 0, 0, 0,
-	     0, 0, 0);
-      C775UNLOCK;
-      return (ERROR);
+      if (index->nevents[id] > 0)
+	C775_EXEC_SET_EVTREADCNT(id, evID[id]);
+      C775_EXEC_FORGET_READY(id);	/* The chain drained every TDC */
     }
+  C775UNLOCK_ALL;
 
-  C775UNLOCK;
-  return (OK);
+  index->nwords = xferCount;
+  return (xferCount);
 }
 
 
-
 /*******************************************************************************
 *
-* c775Sparse - Enable/Disable Overflow and Under threshold sparsification
+* Block scan kernels.  Classifying the words is the only part of a block
+* scan that touches every word, so it is done with vector instructions
+* where the CPU has them, into masks of one bit per word.  The event walk
+* (c775ScanBlock) then only looks at the masks and at the headers.
 *
-*
-* RETURNS: Bit Set 2 Register value.
 */
 
-UINT16
-c775Sparse(int id, int over, int under)
+typedef void (*C775SCANFUNCPTR) (const UINT32 *, int, int, c775_scanmask *);
+typedef void (*C775DECODEFUNCPTR) (const UINT32 *, int, int, UINT32,
+				   c775_hits *);
+typedef void (*C775SWAPFUNCPTR) (volatile UINT32 *, int);
+
+LOCAL int c775Simd = C775_SIMD_SCALAR;
+LOCAL C775SCANFUNCPTR c775ScanMasks = NULL;
+LOCAL C775DECODEFUNCPTR c775DecodeHits = NULL;
+LOCAL C775SWAPFUNCPTR c775SwapWords = NULL;
+
+LOCAL void
+c775ScanMasksFrom(const UINT32 * data, int first, int nwrds, int swap,
+		  c775_scanmask * m)
 {
-  UINT16 rval;
+  int ii;
+  UINT32 word, type, prev = 0;
+  unsigned long long bit;
 
-  if ((id < 0) || (c775p[id] == NULL))
+  if (first > 0)
+    prev = swap ? LSWAP(data[first - 1]) : data[first - 1];
+
+  for (ii = first; ii < nwrds; ii++)
     {
-      printf("c775Sparse: ERROR : TDC id %d not initialized \n", id);
-      return (0xffff);
+      word = swap ? LSWAP(data[ii]) : data[ii];
+      type = word & C775_DATA_ID_MASK;
+      bit = 1ULL << (ii & 63);
+
+      if (type == C775_HEADER_DATA)
+	m->hdr[ii >> 6] |= bit;
+      else if (type == C775_TRAILER_DATA)
+	m->trl[ii >> 6] |= bit;
+      else if (type == C775_INVALID_DATA)
+	m->fill[ii >> 6] |= bit;
+      if (type != C775_DATA)
+	m->nond[ii >> 6] |= bit;
+      if ((ii > 0) && ((word ^ prev) & C775_GEO_ADDR_MASK))
+	m->geoc[ii >> 6] |= bit;
+      prev = word;
     }
+}
 
-  C775LOCK;
-  if (!over)
-    {				/* Set Overflow suppression */
-      vmeWrite16(&c775p[id]->main.bitSet2, C775_OVER_RANGE);
-    }
-  else
+LOCAL void
+c775ScanMasksScalar(const UINT32 * data, int nwrds, int swap,
+		    c775_scanmask * m)
+{
+  c775ScanMasksFrom(data, 0, nwrds, swap, m);
+}
+
+#ifdef C775_X86_SIMD
+LOCAL __attribute__ ((target ("sse4.1"))) void
+c775ScanMasksSSE4(const UINT32 * data, int nwrds, int swap,
+		  c775_scanmask * m)
+{
+  const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+				      11, 10, 9, 8, 15, 14, 13, 12);
+  const __m128i tmask = _mm_set1_epi32(C775_DATA_ID_MASK);
+  const __m128i gmask = _mm_set1_epi32(C775_GEO_ADDR_MASK);
+  const __m128i thdr = _mm_set1_epi32(C775_HEADER_DATA);
+  const __m128i ttrl = _mm_set1_epi32(C775_TRAILER_DATA);
+  const __m128i tfill = _mm_set1_epi32(C775_INVALID_DATA);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v, t, g, gp, gprev = zero;
+  int ii, iw, shift;
+
+#define C775_MASK4(x) ((unsigned long long) _mm_movemask_ps(_mm_castsi128_ps(x)))
+
+  for (ii = 0; ii + 4 <= nwrds; ii += 4)
     {
-      vmeWrite16(&c775p[id]->main.bitClear2, C775_OVER_RANGE);
+      v = _mm_loadu_si128((const __m128i *) &data[ii]);
+      if (swap)
+	v = _mm_shuffle_epi8(v, bswap);
+      t = _mm_and_si128(v, tmask);
+      g = _mm_and_si128(v, gmask);
+      /* GEO of the previous word: [last of previous vector, g0, g1, g2] */
+      gp = _mm_alignr_epi8(g, gprev, 12);
+      gprev = g;
+
+      iw = ii >> 6;
+      shift = ii & 63;
+      m->hdr[iw] |= C775_MASK4(_mm_cmpeq_epi32(t, thdr)) << shift;
+      m->trl[iw] |= C775_MASK4(_mm_cmpeq_epi32(t, ttrl)) << shift;
+      m->fill[iw] |= C775_MASK4(_mm_cmpeq_epi32(t, tfill)) << shift;
+      m->nond[iw] |= (C775_MASK4(_mm_cmpeq_epi32(t, zero)) ^ 0xf) << shift;
+      m->geoc[iw] |= (C775_MASK4(_mm_cmpeq_epi32(g, gp)) ^ 0xf) << shift;
     }
+#undef C775_MASK4
 
-  if (!under)
-    {				/* Set Underflow suppression */
-      vmeWrite16(&c775p[id]->main.bitSet2, C775_LOW_THRESHOLD);
-    }
-  else
+  /* The first word has no previous word */
+  m->geoc[0] &= ~1ULL;
+  c775ScanMasksFrom(data, ii, nwrds, swap, m);
+}
+
+LOCAL __attribute__ ((target ("avx2"))) void
+c775ScanMasksAVX2(const UINT32 * data, int nwrds, int swap,
+		  c775_scanmask * m)
+{
+  const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+					 11, 10, 9, 8, 15, 14, 13, 12,
+					 3, 2, 1, 0, 7, 6, 5, 4,
+					 11, 10, 9, 8, 15, 14, 13, 12);
+  const __m256i tmask = _mm256_set1_epi32(C775_DATA_ID_MASK);
+  const __m256i gmask = _mm256_set1_epi32(C775_GEO_ADDR_MASK);
+  const __m256i thdr = _mm256_set1_epi32(C775_HEADER_DATA);
+  const __m256i ttrl = _mm256_set1_epi32(C775_TRAILER_DATA);
+  const __m256i tfill = _mm256_set1_epi32(C775_INVALID_DATA);
+  const __m256i rot = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+  const __m256i last = _mm256_set1_epi32(7);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i v, t, g, gp, gprev = zero;
+  int ii, iw, shift;
+
+#define C775_MASK8(x) ((unsigned long long) _mm256_movemask_ps(_mm256_castsi256_ps(x)))
+
+  for (ii = 0; ii + 8 <= nwrds; ii += 8)
     {
-      vmeWrite16(&c775p[id]->main.bitClear2, C775_LOW_THRESHOLD);
+      v = _mm256_loadu_si256((const __m256i *) &data[ii]);
+      if (swap)
+	v = _mm256_shuffle_epi8(v, bswap);
+      t = _mm256_and_si256(v, tmask);
+      g = _mm256_and_si256(v, gmask);
+      /* GEO of the previous word: [last of previous vector, g0 .. g6] */
+      gp = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(g, rot), gprev,
+			      0x01);
+      gprev = _mm256_permutevar8x32_epi32(g, last);
+
+      iw = ii >> 6;
+      shift = ii & 63;
+      m->hdr[iw] |= C775_MASK8(_mm256_cmpeq_epi32(t, thdr)) << shift;
+      m->trl[iw] |= C775_MASK8(_mm256_cmpeq_epi32(t, ttrl)) << shift;
+      m->fill[iw] |= C775_MASK8(_mm256_cmpeq_epi32(t, tfill)) << shift;
+      m->nond[iw] |= (C775_MASK8(_mm256_cmpeq_epi32(t, zero)) ^ 0xff) << shift;
+      m->geoc[iw] |= (C775_MASK8(_mm256_cmpeq_epi32(g, gp)) ^ 0xff) << shift;
     }
-  rval = vmeRead16(&c775p[id]->main.bitSet2) & C775_BITSET2_MASK;
+#undef C775_MASK8
 
-  C775UNLOCK;
-  return (rval);
-}
+  /* Leave no dirty upper state for the SSE code that follows */
+  _mm256_zeroupper();
 
+  /* The first word has no previous word */
+  m->geoc[0] &= ~1ULL;
+  c775ScanMasksFrom(data, ii, nwrds, swap, m);
+}
+#endif /* C775_X86_SIMD */
 
 /*******************************************************************************
 *
-* c775Dready - Return status of Data Ready bit in TDC
-*
+* Hit decode kernels.  Each datum is split into the arrays of a c775_hits;
+* the byte shuffles that pick out the GEO, channel and flag bytes also
+* do the byte swap, when one is needed.
 *
-* RETURNS: 0(No Data) or  # of events in FIFO (1-32) or ERROR.
 */
 
-int
-c775Dready(int id)
+LOCAL void
+c775DecodeHitsFrom(const UINT32 * data, int first, int nwrds, int swap,
+		   UINT32 event, c775_hits * hits)
 {
+  int ii, k;
+  UINT32 word;
 
-  int nevts = 0;
-  UINT16 stat = 0;
+  for (ii = first; ii < nwrds; ii++)
+    {
+      word = swap ? LSWAP(data[ii]) : data[ii];
+      k = hits->nhits + ii;
+      hits->board[k] = (word & C775_GEO_ADDR_MASK) >> 27;
+      hits->channel[k] = (word & C775_TDC_CHANNEL_MASK) >> 16;
+      hits->flags[k] = (word & C775_TDC_FLAGS_MASK) >> 12;
+      hits->value[k] = word & C775_TDC_DATA_MASK;
+      hits->event[k] = event;
+    }
+}
 
+LOCAL void
+c775DecodeHitsScalar(const UINT32 * data, int nwrds, int swap, UINT32 event,
+		     c775_hits * hits)
+{
+  c775DecodeHitsFrom(data, 0, nwrds, swap, event, hits);
+}
 
-  if ((id < 0) || (c775p[id] == NULL))
+#ifdef C775_X86_SIMD
+/* Byte of a (host order) word at memory offset: byte 3 is bits 31-24 */
+#define C775_BYTE(lane, b, swap)  ((lane) * 4 + ((swap) ? 3 - (b) : (b)))
+
+/* GEO (byte 3), channel (byte 2) and flag (byte 1) bytes of 4 words, and
+   the low 16 bits of 4 words */
+#define C775_SHUF_GCF(s)						\
+  _mm_setr_epi8(C775_BYTE(0, 3, s), C775_BYTE(1, 3, s),		\
+		C775_BYTE(2, 3, s), C775_BYTE(3, 3, s),			\
+		C775_BYTE(0, 2, s), C775_BYTE(1, 2, s),			\
+		C775_BYTE(2, 2, s), C775_BYTE(3, 2, s),			\
+		C775_BYTE(0, 1, s), C775_BYTE(1, 1, s),			\
+		C775_BYTE(2, 1, s), C775_BYTE(3, 1, s),			\
+		-1, -1, -1, -1)
+#define C775_SHUF_VAL(s)						\
+  _mm_setr_epi8(C775_BYTE(0, 0, s), C775_BYTE(0, 1, s),		\
+		C775_BYTE(1, 0, s), C775_BYTE(1, 1, s),			\
+		C775_BYTE(2, 0, s), C775_BYTE(2, 1, s),			\
+		C775_BYTE(3, 0, s), C775_BYTE(3, 1, s),			\
+		-1, -1, -1, -1, -1, -1, -1, -1)
+
+/* GEO >> 3, channel, flags >> 4 from the shuffled bytes */
+#define C775_GCF(x, m)							\
+  _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi16(x, 3), (m)[0]), \
+			    _mm_and_si128(x, (m)[1])),			\
+	       _mm_and_si128(_mm_srli_epi16(x, 4), (m)[2]))
+
+LOCAL __attribute__ ((target ("sse4.1"))) void
+c775DecodeHitsSSE4(const UINT32 * data, int nwrds, int swap, UINT32 event,
+		   c775_hits * hits)
+{
+  const __m128i gcf = swap ? C775_SHUF_GCF(1) : C775_SHUF_GCF(0);
+  const __m128i val = swap ? C775_SHUF_VAL(1) : C775_SHUF_VAL(0);
+  const __m128i vmask = _mm_set1_epi16(C775_TDC_DATA_MASK);
+  const __m128i ev = _mm_set1_epi32(event);
+  __m128i m[3], v, x;
+  int ii, k, d;
+
+  m[0] = _mm_setr_epi32(0x1f1f1f1f, 0, 0, 0);
+  m[1] = _mm_setr_epi32(0, 0x1f1f1f1f, 0, 0);
+  m[2] = _mm_setr_epi32(0, 0, 0x07070707, 0);
+
+  for (ii = 0; ii + 4 <= nwrds; ii += 4)
     {
-      logMsg("c775Dready: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return (ERROR);
+      k = hits->nhits + ii;
+      v = _mm_loadu_si128((const __m128i *) &data[ii]);
+
+      x = _mm_shuffle_epi8(v, gcf);
+      x = C775_GCF(x, m);
+      d = _mm_extract_epi32(x, 0);
+      memcpy(&hits->board[k], &d, 4);
+      d = _mm_extract_epi32(x, 1);
+      memcpy(&hits->channel[k], &d, 4);
+      d = _mm_extract_epi32(x, 2);
+      memcpy(&hits->flags[k], &d, 4);
+
+      x = _mm_and_si128(_mm_shuffle_epi8(v, val), vmask);
+      _mm_storel_epi64((__m128i *) & hits->value[k], x);
+      _mm_storeu_si128((__m128i *) & hits->event[k], ev);
     }
 
-  C775LOCK;
-  stat = vmeRead16(&c775p[id]->main.status1) & C775_DATA_READY;
-  if (stat)
+  c775DecodeHitsFrom(data, ii, nwrds, swap, event, hits);
+}
+
+LOCAL __attribute__ ((target ("avx2"))) void
+c775DecodeHitsAVX2(const UINT32 * data, int nwrds, int swap, UINT32 event,
+		   c775_hits * hits)
+{
+  const __m256i gcf = swap ?
+    _mm256_broadcastsi128_si256(C775_SHUF_GCF(1)) :
+    _mm256_broadcastsi128_si256(C775_SHUF_GCF(0));
+  const __m256i val = swap ?
+    _mm256_broadcastsi128_si256(C775_SHUF_VAL(1)) :
+    _mm256_broadcastsi128_si256(C775_SHUF_VAL(0));
+  const __m256i vmask = _mm256_set1_epi16(C775_TDC_DATA_MASK);
+  const __m256i ev = _mm256_set1_epi32(event);
+  /* Interleave the two halves: GEO 0-7, channel 0-7, flags 0-7 */
+  const __m256i halves = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  const __m256i mgeo = _mm256_setr_epi32(0x1f1f1f1f, 0, 0, 0,
+					 0x1f1f1f1f, 0, 0, 0);
+  const __m256i mchan = _mm256_setr_epi32(0, 0x1f1f1f1f, 0, 0,
+					  0, 0x1f1f1f1f, 0, 0);
+  const __m256i mflag = _mm256_setr_epi32(0, 0, 0x07070707, 0,
+					  0, 0, 0x07070707, 0);
+  __m256i v, x;
+  __m128i lo;
+  int ii, k;
+
+  for (ii = 0; ii + 8 <= nwrds; ii += 8)
     {
-      C775_EXEC_READ_EVENT_COUNT(id);
-      nevts = c775EventCount[id] - c775EvtReadCnt[id];
-      if (nevts <= 0)
-	{
-	  logMsg("c775Dready: ERROR : Bad Event Ready Count (nevts = %d)\n",
-		 nevts, 0, 0, 0, 0, 0);
-	  C775UNLOCK;
-	  return (ERROR);
-	}
+      k = hits->nhits + ii;
+      v = _mm256_loadu_si256((const __m256i *) &data[ii]);
+
+      x = _mm256_shuffle_epi8(v, gcf);
+      x = _mm256_or_si256(_mm256_or_si256
+			  (_mm256_and_si256(_mm256_srli_epi16(x, 3), mgeo),
+			   _mm256_and_si256(x, mchan)),
+			  _mm256_and_si256(_mm256_srli_epi16(x, 4), mflag));
+      x = _mm256_permutevar8x32_epi32(x, halves);
+      lo = _mm256_castsi256_si128(x);
+      _mm_storel_epi64((__m128i *) & hits->board[k], lo);
+      _mm_storel_epi64((__m128i *) & hits->channel[k],
+		       _mm_srli_si128(lo, 8));
+      _mm_storel_epi64((__m128i *) & hits->flags[k],
+		       _mm256_extracti128_si256(x, 1));
+
+      x = _mm256_and_si256(_mm256_shuffle_epi8(v, val), vmask);
+      x = _mm256_permute4x64_epi64(x, 0x08);
+      _mm_storeu_si128((__m128i *) & hits->value[k],
+		       _mm256_castsi256_si128(x));
+      _mm256_storeu_si256((__m256i *) & hits->event[k], ev);
     }
+  _mm256_zeroupper();
 
-  C775UNLOCK;
-  return (nevts);
+  c775DecodeHitsFrom(data, ii, nwrds, swap, event, hits);
 }
-
+#undef C775_GCF
+#undef C775_SHUF_VAL
+#undef C775_SHUF_GCF
+#undef C775_BYTE
+#endif /* C775_X86_SIMD */
 
 /*******************************************************************************
 *
-* c775SetFSR - Set and/or Return TDC full scale range programming
-*
-*      Register value:    0xff (255) ->  35 ps/count  (  140ns FSR )
-*       range between:    0x1e ( 30) -> 300 ps/count  ( 1200ns FSR )
-*
-*        FSR = 4*(290-reg)
-*
-*        reg = 290 - FSR/4
-*
-*      Note: Passing 0 for fsr will return the contents of the register
-*            but not set it.
+* Byte swap kernels, in place.
 *
-* RETURNS: Full scale range of the TDC in nanoseconds or ERROR.
 */
 
-int
-c775SetFSR(int id, UINT16 fsr)
+LOCAL void
+c775SwapWordsFrom(volatile UINT32 * data, int first, int nwrds)
+{
+  int ii;
+
+  for (ii = first; ii < nwrds; ii++)
+    data[ii] = LSWAP(data[ii]);
+}
+
+LOCAL void
+c775SwapWordsScalar(volatile UINT32 * data, int nwrds)
+{
+  c775SwapWordsFrom(data, 0, nwrds);
+}
+
+#ifdef C775_X86_SIMD
+LOCAL __attribute__ ((target ("ssse3"))) void
+c775SwapWordsSSSE3(volatile UINT32 * data, int nwrds)
+{
+  const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+				      11, 10, 9, 8, 15, 14, 13, 12);
+  __m128i *p;
+  int ii;
+
+  for (ii = 0; ii + 8 <= nwrds; ii += 8)
+    {
+      p = (__m128i *) & data[ii];
+      _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), bswap));
+      _mm_storeu_si128(p + 1,
+		       _mm_shuffle_epi8(_mm_loadu_si128(p + 1), bswap));
+    }
+
+  c775SwapWordsFrom(data, ii, nwrds);
+}
+
+LOCAL __attribute__ ((target ("avx2"))) void
+c775SwapWordsAVX2(volatile UINT32 * data, int nwrds)
+{
+  const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+					 11, 10, 9, 8, 15, 14, 13, 12,
+					 3, 2, 1, 0, 7, 6, 5, 4,
+					 11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i *p;
+  int ii;
+
+  for (ii = 0; ii + 16 <= nwrds; ii += 16)
+    {
+      p = (__m256i *) & data[ii];
+      _mm256_storeu_si256(p,
+			  _mm256_shuffle_epi8(_mm256_loadu_si256(p), bswap));
+      _mm256_storeu_si256(p + 1,
+			  _mm256_shuffle_epi8(_mm256_loadu_si256(p + 1),
+					      bswap));
+    }
+  _mm256_zeroupper();
+
+  c775SwapWordsFrom(data, ii, nwrds);
+}
+#endif /* C775_X86_SIMD */
+
+/*******************************************************************************
+*
+* c775SetSimd - Select the vector instruction set used by the block
+*               scan/decode kernels.  By default the best one supported
+*               by the CPU is used.
+*
+* INPUTS:    level - C775_SIMD_AUTO, C775_SIMD_SCALAR, C775_SIMD_SSE4
+*                    or C775_SIMD_AVX2.  A level the CPU does not support
+*                    falls back to the best one it does.
+*
+* RETURNS: The level in use.
+*/
+
+int
+c775SetSimd(int level)
+{
+  int best = C775_SIMD_SCALAR;
+
+#ifdef C775_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    best = C775_SIMD_AVX2;
+  else if (__builtin_cpu_supports("sse4.1"))
+    best = C775_SIMD_SSE4;
+#endif
+
+  if ((level < 0) || (level > best))
+    level = best;
+
+  switch (level)
+    {
+#ifdef C775_X86_SIMD
+    case C775_SIMD_AVX2:
+      c775ScanMasks = c775ScanMasksAVX2;
+      c775DecodeHits = c775DecodeHitsAVX2;
+      c775SwapWords = c775SwapWordsAVX2;
+      break;
+    case C775_SIMD_SSE4:
+      c775ScanMasks = c775ScanMasksSSE4;
+      c775DecodeHits = c775DecodeHitsSSE4;
+      c775SwapWords = c775SwapWordsSSSE3;
+      break;
+#endif
+    default:
+      c775ScanMasks = c775ScanMasksScalar;
+      c775DecodeHits = c775DecodeHitsScalar;
+      c775SwapWords = c775SwapWordsScalar;
+    }
+  c775Simd = level;
+
+  return (level);
+}
+
+/*******************************************************************************
+*
+* c775SwapBlock - Byte swap a block of longwords in place, e.g. from VME
+*                 (big endian) to CPU byte order on a little endian CPU.
+*
+* RETURNS: N/A
+*/
+
+void
+c775SwapBlock(volatile UINT32 * data, int nwrds)
+{
+  if (c775SwapWords == NULL)
+    c775SetSimd(C775_SIMD_AUTO);
+
+  (*c775SwapWords) (data, nwrds);
+}
+
+/*******************************************************************************
+*
+* c775SetBlockSwap - Choose the byte order of block read data
+*                    (c775ReadBlock, c775ReadBlockWait, c775ReadEvents,
+*                    c775ReadCBLT).
+*
+*    By default the data is left as the DMA wrote it, in VME (big endian)
+*    byte order, as wanted by big endian output formats.  With swapping
+*    enabled every block is swapped to CPU byte order once, in place,
+*    right after the DMA, so consumers need no LSWAP.  Has no effect on a
+*    big endian CPU.
+*
+* INPUTS:    enable - 1 to swap block read data to CPU byte order
+*                     0 to leave it in VME byte order (default)
+*
+* RETURNS: The previous setting.
+*/
+
+int
+c775SetBlockSwap(int enable)
+{
+  int prev = c775BlockSwap;
+
+#ifndef VXWORKS
+  c775BlockSwap = enable ? 1 : 0;
+#endif
+
+  return (prev);
+}
+
+/* First position in a..b-1 whose mask bit is set (set = 1) or clear
+   (set = 0), b if there is none */
+LOCAL int
+c775MaskFind(const unsigned long long *mask, int a, int b, int set)
+{
+  unsigned long long bits;
+
+  while (a < b)
+    {
+      bits = set ? mask[a >> 6] : ~mask[a >> 6];
+      bits >>= (a & 63);
+      if (bits)
+	{
+	  a += __builtin_ctzll(bits);
+	  return ((a < b) ? a : b);
+	}
+      a = (a | 63) + 1;
+    }
+  return (b);
+}
+
+/*******************************************************************************
+*
+* c775ScanBlock - Classify and validate every word of a block of TDC data
+*                 (e.g. from c775ReadEvents or c775ReadCBLT) and index its
+*                 events, in one pass.
+*
+*    Every event must be a header, as many valid data words as the header
+*    word count says, and a trailer, all with the same GEO address.  Only
+*    not valid datum words (filler) may sit between events.  Events from
+*    different TDCs (CBLT) may follow each other.
+*
+* INPUTS:    data  - block of data
+*            nwrds - number of longwords in the block
+*                    (at most C775_MAX_SCAN_WORDS are scanned)
+*            swap  - 1 if the words must be byte swapped first (data in
+*                    VME, big endian, byte order on a little endian CPU)
+*            scan  - filled with the header position and GEO address of
+*                    every event.  If the block is not valid, the events
+*                    before the error and the reason and word at which
+*                    the scan stopped.  Its mask member is the scan's
+*                    work space.
+*
+* RETURNS: Number of events, or ERROR if the block is not valid.
+*/
+
+int
+c775ScanBlock(volatile UINT32 * data, int nwrds, int swap, c775_scan * scan)
+{
+  c775_scanmask *m = &scan->mask;
+  int nmask, pos = 0, end = 0, ii, hdr, trl, nWords, nevts = 0;
+  int error = C775_SCAN_OK;
+  UINT32 header;
+
+  if (nwrds > C775_MAX_SCAN_WORDS)
+    nwrds = C775_MAX_SCAN_WORDS;
+  if (nwrds < 0)
+    nwrds = 0;
+
+  if (c775ScanMasks == NULL)
+    c775SetSimd(C775_SIMD_AUTO);
+
+  nmask = ((nwrds + 63) >> 6) * sizeof(unsigned long long);
+  memset(m->hdr, 0, nmask);
+  memset(m->trl, 0, nmask);
+  memset(m->fill, 0, nmask);
+  memset(m->nond, 0, nmask);
+  memset(m->geoc, 0, nmask);
+  (*c775ScanMasks) ((const UINT32 *) data, nwrds, swap, m);
+
+  while (pos < nwrds)
+    {
+      hdr = c775MaskFind(m->hdr, pos, nwrds, 1);
+
+      /* Only filler between events */
+      ii = c775MaskFind(m->fill, pos, hdr, 0);
+      if (ii < hdr)
+	{
+	  error = C775_SCAN_ORPHAN;
+	  pos = ii;
+	  break;
+	}
+      if (hdr == nwrds)
+	{
+	  pos = nwrds;
+	  break;
+	}
+
+      header = swap ? LSWAP(data[hdr]) : data[hdr];
+      nWords = (header & C775_WORDCOUNT_MASK) >> 8;
+      trl = hdr + nWords + 1;
+
+      if (nWords > C775_MAX_CHANNELS)
+	error = C775_SCAN_BAD_COUNT;
+      else if (trl >= nwrds)
+	error = C775_SCAN_TRUNCATED;
+      else if (!((m->trl[trl >> 6] >> (trl & 63)) & 1)
+	       || (c775MaskFind(m->nond, hdr + 1, trl, 1) < trl))
+	error = C775_SCAN_BAD_COUNT;
+      else if (c775MaskFind(m->geoc, hdr + 1, trl + 1, 1) <= trl)
+	error = C775_SCAN_BAD_GEO;
+      else if (nevts == C775_MAX_SCAN_EVENTS)
+	error = C775_SCAN_OVERFLOW;
+
+      if (error != C775_SCAN_OK)
+	{
+	  pos = hdr;
+	  break;
+	}
+
+      scan->offset[nevts] = hdr;
+      scan->geo[nevts] = (header & C775_GEO_ADDR_MASK) >> 27;
+      nevts++;
+      pos = end = trl + 1;
+    }
+
+  scan->nevents = nevts;
+  scan->offset[nevts] = end;
+  scan->nwords = pos;
+  scan->error = error;
+  scan->errOffset = pos;
+
+  return ((error == C775_SCAN_OK) ? nevts : ERROR);
+}
+
+
+/*******************************************************************************
+*
+* c775DecodeBlock - Decode every event of a block of TDC data into hits,
+*                   as a structure of arrays in caller memory.
+*
+*    Each valid datum becomes one hit: GEO address, channel, 12 bit
+*    value, overflow/underflow/valid flags and the event number of its
+*    trailer.  Headers and trailers are only used to find the events, and
+*    filler between events is skipped.  The data words are not checked
+*    (see c775ScanBlock).
+*
+* INPUTS:    data  - block of data (e.g. from c775ReadEvents or c775ReadCBLT)
+*            nwrds - number of longwords in the block
+*            swap  - 1 if the words must be byte swapped first (data in
+*                    VME, big endian, byte order on a little endian CPU)
+*            hits  - arrays to fill, maxhits long.  Decoding stops before
+*                    an event that does not fit; nwords tells how much of
+*                    the block was decoded.
+*
+* RETURNS: Number of events decoded, or ERROR on a bad header or trailer.
+*/
+
+int
+c775DecodeBlock(volatile UINT32 * data, int nwrds, int swap, c775_hits * hits)
+{
+  int ii = 0, nWords, rval = 0;
+  UINT32 header, trailer;
+
+  if (c775DecodeHits == NULL)
+    c775SetSimd(C775_SIMD_AUTO);
+
+  hits->nhits = 0;
+  hits->nevents = 0;
+
+  while (ii < nwrds)
+    {
+      header = swap ? LSWAP(data[ii]) : data[ii];
+      if ((header & C775_DATA_ID_MASK) == C775_INVALID_DATA)
+	{
+	  ii++;
+	  continue;
+	}
+      if ((header & C775_DATA_ID_MASK) != C775_HEADER_DATA)
+	{
+	  logMsg("c775DecodeBlock: ERROR: Invalid Header Word 0x%08x\n",
+		 header, 0, 0, 0, 0, 0);
+	  rval = ERROR;
+	  break;
+	}
+
+      nWords = (header & C775_WORDCOUNT_MASK) >> 8;
+      if ((ii + nWords + 1) >= nwrds)
+	{
+	  logMsg("c775DecodeBlock: ERROR: Truncated event at word %d\n", ii,
+		 0, 0, 0, 0, 0);
+	  rval = ERROR;
+	  break;
+	}
+      trailer = swap ? LSWAP(data[ii + nWords + 1]) : data[ii + nWords + 1];
+      if ((trailer & C775_DATA_ID_MASK) != C775_TRAILER_DATA)
+	{
+	  logMsg("c775DecodeBlock: ERROR: Invalid Trailer Word 0x%08x\n",
+		 trailer, 0, 0, 0, 0, 0);
+	  rval = ERROR;
+	  break;
+	}
+
+      if ((hits->nhits + nWords) > hits->maxhits)
+	break;
+
+      (*c775DecodeHits) ((const UINT32 *) &data[ii + 1], nWords, swap,
+			 trailer & C775_EVENTCOUNT_MASK, hits);
+      hits->nhits += nWords;
+      hits->nevents++;
+      ii += nWords + 2;
+    }
+  hits->nwords = ii;
+
+  return ((rval == ERROR) ? ERROR : hits->nevents);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxIntRingInit - Set up the interrupt readout ring.
+*
+*    With no user routine connected (c775IntConnect(NULL,...) or
+*    c775IntConnectBoard(id,NULL,...)), the interrupt handler drains the
+*    interrupting TDC with c775ReadEvents into the next free ring buffer.
+*    Consumers take the events with c775IntRingRead, without going to the
+*    bus, and can sleep in c775IntRingWait until there are some.  The ring
+*    has one producer (the handler) and one consumer thread: every TDC
+*    feeding the ring must interrupt on the same level, so that their
+*    handlers never run at the same time.
+*
+*    When every buffer is full the TDC interrupt is held off (evTrigger
+*    cleared), and re-armed by the consumer as soon as a buffer is free.
+*
+* INPUTS:    nslots   - number of buffers (2 - C775_MAX_RING_SLOTS),
+*                       0 to stop using the ring
+*            bufs     - the buffers (DMA memory)
+*            bufwords - size of each buffer in longwords
+*                       (C775_MAX_BLOCK_WORDS + 2 holds a full TDC)
+*
+* RETURNS: OK, or ERROR if interrupts are running or the arguments are
+*          out of range.
+*/
+
+STATUS
+c775CtxIntRingInit(c775_ctx * ctx, int nslots, volatile UINT32 ** bufs,
+		   int bufwords)
+{
+  int ii;
+
+  if (ctx->intRunning)
+    {
+      printf("c775IntRingInit: ERROR : Interrupts are running\n");
+      return (ERROR);
+    }
+
+  if ((nslots != 0)
+      && ((nslots < 2) || (nslots > C775_MAX_RING_SLOTS) || (bufs == NULL)
+	  || (bufwords <= 0)))
+    {
+      printf("c775IntRingInit: ERROR: Invalid ring (%d buffers of %d words)\n",
+	     nslots, bufwords);
+      return (ERROR);
+    }
+
+  for (ii = 0; ii < nslots; ii++)
+    {
+      if (bufs[ii] == NULL)
+	{
+	  printf("c775IntRingInit: ERROR: Buffer %d is NULL\n", ii);
+	  return (ERROR);
+	}
+      ctx->ring.buf[ii] = bufs[ii];
+    }
+
+  ctx->ring.bufwords = bufwords;
+  ctx->ring.head = 0;
+  ctx->ring.tail = 0;
+  ctx->ring.ev = 0;
+  ctx->ring.stalled = 0;
+  ctx->ring.stalls = 0;
+  ctx->ring.nslots = nslots;
+
+  return (OK);
+}
+
+#ifndef VXWORKS
+/* Interrupt side: wake the application, once per batch */
+LOCAL void
+c775IntFdSignal(c775_ctx * ctx)
+{
+  if ((ctx->intFd >= 0)
+      && __atomic_exchange_n(&ctx->intFdNotify, 0, __ATOMIC_SEQ_CST))
+    {
+      if (eventfd_write(ctx->intFd, 1) < 0)
+	perror("c775IntFdSignal: eventfd_write");
+    }
+}
+
+/* Application side: clear the eventfd, and have the next interrupt write
+   it again */
+LOCAL void
+c775IntFdRearm(c775_ctx * ctx)
+{
+  eventfd_t cnt;
+
+  if (ctx->intFd < 0)
+    return;
+  eventfd_read(ctx->intFd, &cnt);	/* EAGAIN if already clear */
+  __atomic_store_n(&ctx->intFdNotify, 1, __ATOMIC_SEQ_CST);
+}
+#endif
+
+/* Producer: called from the interrupt handler for the interrupting TDC.
+   Returns the number of events taken */
+LOCAL int
+c775IntRingFill(c775_ctx * ctx, int id)
+{
+  unsigned int head = ctx->ring.head;
+  int islot, nevts;
+
+  if (head - __atomic_load_n(&ctx->ring.tail, __ATOMIC_ACQUIRE)
+      == (unsigned int) ctx->ring.nslots)
+    {
+      /* Full.  The TDC keeps its interrupt asserted while it holds
+         evTrigger events, so turn it off until a buffer is free. */
+      C775LOCK(id);
+      C775_WRITE(id, evTrigger, 0);
+      C775UNLOCK(id);
+      ctx->ring.stalls++;
+      __atomic_fetch_or(&ctx->ring.stalled, 1u << id, __ATOMIC_SEQ_CST);
+      return (0);
+    }
+
+  islot = head % ctx->ring.nslots;
+  nevts = c775CtxReadEvents(ctx, id, ctx->ring.buf[islot], ctx->ring.bufwords,
+			 &ctx->ring.index[islot]);
+  if (nevts <= 0)
+    return (0);
+  ctx->ring.id[islot] = id;
+  __atomic_store_n(&ctx->ring.head, head + 1, __ATOMIC_RELEASE);
+
+#ifdef VXWORKS
+  semGive(ctx->sem);
+#else
+  pthread_mutex_lock(&ctx->ringMutex);
+  pthread_cond_signal(&ctx->ringCond);
+  pthread_mutex_unlock(&ctx->ringMutex);
+  c775IntFdSignal(ctx);
+#endif
+
+  return (nevts);
+}
+
+/* Consumer: re-arm the TDC interrupts held off with the ring full */
+LOCAL void
+c775IntRingUnstall(c775_ctx * ctx)
+{
+  unsigned int stalled;
+  int id;
+
+  stalled = __atomic_exchange_n(&ctx->ring.stalled, 0, __ATOMIC_SEQ_CST);
+  for (id = 0; stalled != 0; id++, stalled >>= 1)
+    {
+      if (!(stalled & 1))
+	continue;
+      C775LOCK(id);
+      if (ctx->intBd[id].enabled)
+	C775_WRITE(id, evTrigger, ctx->intBd[id].evCount);
+      C775UNLOCK(id);
+    }
+}
+
+/*******************************************************************************
+*
+* c775CtxIntRingCount - Return the number of events waiting in the interrupt
+*                    readout ring.
+*
+* RETURNS: Number of events, or ERROR if the ring is not in use.
+*/
+
+int
+c775CtxIntRingCount(c775_ctx * ctx)
+{
+  unsigned int slot, head;
+  int nevts;
+
+  if (ctx->ring.nslots == 0)
+    return (ERROR);
+
+  head = __atomic_load_n(&ctx->ring.head, __ATOMIC_ACQUIRE);
+  nevts = -ctx->ring.ev;
+  for (slot = ctx->ring.tail; slot != head; slot++)
+    nevts += ctx->ring.index[slot % ctx->ring.nslots].nevents;
+
+  return (nevts);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntRingRead - Take the next event from the interrupt readout ring.
+*
+* INPUTS:    data     - address of data destination
+*            maxwords - size of data in longwords
+*            id       - if not NULL, set to the TDC the event came from
+*
+* RETURNS: Number of words of the event (header to trailer, in CPU byte
+*          order), 0 if the ring is empty, or ERROR.
+*/
+
+int
+c775CtxIntRingRead(c775_ctx * ctx, UINT32 * data, int maxwords, int *id)
+{
+  unsigned int tail = ctx->ring.tail;
+  int ii, islot, first, nWords;
+  volatile UINT32 *buf;
+  c775_evindex *index;
+
+  if (ctx->ring.nslots == 0)
+    {
+      logMsg("c775IntRingRead: ERROR : Ring not initialized\n", 0, 0, 0, 0,
+	     0, 0);
+      return (ERROR);
+    }
+
+  if (tail == __atomic_load_n(&ctx->ring.head, __ATOMIC_ACQUIRE))
+    {
+#ifndef VXWORKS
+      /* Empty: the next filled buffer wakes the eventfd.  Look again,
+         it may have been filled before the eventfd was re-armed. */
+      c775IntFdRearm(ctx);
+      if (tail == __atomic_load_n(&ctx->ring.head, __ATOMIC_SEQ_CST))
+#endif
+	{
+	  c775IntRingUnstall(ctx);
+	  return (0);
+	}
+    }
+
+  islot = tail % ctx->ring.nslots;
+  buf = ctx->ring.buf[islot];
+  index = &ctx->ring.index[islot];
+  first = index->offset[ctx->ring.ev];
+  nWords = index->offset[ctx->ring.ev + 1] - first;
+  if (nWords > maxwords)
+    {
+      logMsg("c775IntRingRead: ERROR: Event of %d words, room for %d\n",
+	     nWords, maxwords, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  for (ii = 0; ii < nWords; ii++)
+    data[ii] = C775_DMA_WORD(buf[first + ii]);
+  if (id != NULL)
+    *id = ctx->ring.id[islot];
+
+  if (++ctx->ring.ev == index->nevents)
+    {
+      /* Slot done, hand it back to the producer */
+      ctx->ring.ev = 0;
+      __atomic_store_n(&ctx->ring.tail, tail + 1, __ATOMIC_RELEASE);
+      c775IntRingUnstall(ctx);
+    }
+
+  return (nWords);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntRingWait - Sleep until the interrupt readout ring holds events.
+*
+* INPUTS:    msec - longest wait in milliseconds
+*
+* RETURNS: Number of events waiting (0 on timeout), or ERROR if the ring
+*          is not in use.
+*/
+
+int
+c775CtxIntRingWait(c775_ctx * ctx, int msec)
+{
+  int nevts;
+#ifndef VXWORKS
+  struct timespec deadline;
+#endif
+
+  nevts = c775CtxIntRingCount(ctx);
+  if (nevts != 0)
+    return (nevts);
+  c775IntRingUnstall(ctx);
+
+  /* Wake up in time to enforce the latency ceiling */
+  if ((ctx->intLatency > 0) && (msec > ctx->intLatency / 1000))
+    msec = (ctx->intLatency + 999) / 1000;
+
+#ifdef VXWORKS
+  semTake(ctx->sem, (msec * sysClkRateGet()) / 1000 + 1);
+#else
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += msec / 1000;
+  deadline.tv_nsec += (msec % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+
+  pthread_mutex_lock(&ctx->ringMutex);
+  while ((ctx->ring.tail == __atomic_load_n(&ctx->ring.head, __ATOMIC_ACQUIRE))
+	 && (pthread_cond_timedwait(&ctx->ringCond, &ctx->ringMutex,
+				    &deadline) == 0))
+    ;
+  pthread_mutex_unlock(&ctx->ringMutex);
+#endif
+
+  nevts = c775CtxIntRingCount(ctx);
+  if (nevts == 0)
+    c775CtxIntAdaptCheck(ctx);
+
+  return (nevts);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntEventFd - Return an eventfd that becomes readable on TDC
+*                  interrupts, for applications that wait with
+*                  poll/epoll instead of in a c775 call (Linux only).
+*
+*    With the interrupt readout ring (c775IntRingInit) the eventfd is
+*    written when the ring gets events; the application reads them with
+*    c775IntRingRead until it returns 0, which also clears the eventfd.
+*
+*    Without the ring, and without a user routine, the interrupt handler
+*    only holds the interrupting TDC off (evTrigger cleared) and writes
+*    the eventfd: the application takes the TDCs with data with
+*    c775IntEventFdTake, reads them, and re-arms them with c775IntRearm.
+*    Nothing runs in the interrupt thread but the hand-off.
+*
+*    The eventfd is written once per batch: interrupts that come before
+*    the application has taken the previous ones do not wake it again.
+*
+* RETURNS: The eventfd (non-blocking), or ERROR.
+*/
+
+int
+c775CtxIntEventFd(c775_ctx * ctx)
+{
+#ifdef VXWORKS
+  logMsg("c775IntEventFd: ERROR : Not supported under VxWorks\n", 0, 0, 0, 0,
+	 0, 0);
+  return (ERROR);
+#else
+  if (ctx->intFd < 0)
+    {
+      ctx->intFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (ctx->intFd < 0)
+	{
+	  perror("c775IntEventFd: eventfd");
+	  return (ERROR);
+	}
+      ctx->intFdPending = 0;
+      __atomic_store_n(&ctx->intFdNotify, 1, __ATOMIC_SEQ_CST);
+    }
+
+  return (ctx->intFd);
+#endif
+}
+
+/*******************************************************************************
+*
+* c775CtxIntEventFdTake - Clear the interrupt eventfd and return the TDCs
+*                      that interrupted, and are held off, since the last
+*                      call.
+*
+* RETURNS: TDCs with data, one bit per TDC id (0 if none).
+*/
+
+unsigned int
+c775CtxIntEventFdTake(c775_ctx * ctx)
+{
+#ifdef VXWORKS
+  return (0);
+#else
+  c775IntFdRearm(ctx);
+  return (__atomic_exchange_n(&ctx->intFdPending, 0, __ATOMIC_SEQ_CST));
+#endif
+}
+
+/*******************************************************************************
+*
+* c775CtxIntEventFdClose - Close the interrupt eventfd.
+*
+* RETURNS: N/A
+*/
+
+void
+c775CtxIntEventFdClose(c775_ctx * ctx)
+{
+#ifndef VXWORKS
+  int fd = ctx->intFd;
+
+  ctx->intFd = -1;
+  if (fd >= 0)
+    close(fd);
+#endif
+}
+
+
+
+/* Time in microseconds, for interrupt rates */
+LOCAL unsigned long long
+c775Now(void)
+{
+#ifdef VXWORKS
+  return ((unsigned long long) tickGet() * 1000000ULL / sysClkRateGet());
+#else
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((unsigned long long) t.tv_sec * 1000000ULL + t.tv_nsec / 1000);
+#endif
+}
+
+/* Program a new event threshold for an interrupting TDC.  A TDC with its
+   interrupt held off (evTrigger 0: c775IntDisable, full ring) only gets
+   the new value when it is re-armed. */
+LOCAL void
+c775IntSetThreshold(c775_ctx * ctx, int id, int evCnt)
+{
+  C775LOCK(id);
+  ctx->intBd[id].evCount = evCnt;
+  if (ctx->shadow[id].evTrigger != 0)
+    C775_WRITE(id, evTrigger, evCnt);
+  C775UNLOCK(id);
+}
+
+/* Per interrupt: update the rate statistics of the TDC and, in adaptive
+   mode, set its event threshold to the number of triggers expected within
+   the latency ceiling.  nevts is the number of events the interrupt took,
+   0 if not known. */
+LOCAL void
+c775IntAdapt(c775_ctx * ctx, int id, int nevts)
+{
+  c775_intstate *bd = &ctx->intBd[id];
+  unsigned long long now = c775Now(), dt;
+  unsigned int rate;
+  int evCnt;
+
+  bd->winCount++;
+  if (now - bd->winStart >= 1000000ULL)
+    {
+      bd->rate = (unsigned int) ((bd->winCount * 1000000ULL)
+				 / (now - bd->winStart));
+      bd->winStart = now;
+      bd->winCount = 0;
+    }
+
+  dt = now - bd->last;
+  bd->last = now;
+  if (dt == 0)
+    dt = 1;
+  /* Each interrupt stands for (at least) evTrigger triggers */
+  if (nevts <= 0)
+    nevts = bd->evCount;
+  rate = (unsigned int) ((nevts * 1000000ULL) / dt);
+  if (bd->evRate == 0)
+    bd->evRate = rate;
+  else
+    bd->evRate = (3 * bd->evRate + rate) / 4;
+
+  if (ctx->intLatency <= 0)
+    return;
+
+  evCnt = (int) (((unsigned long long) bd->evRate * ctx->intLatency)
+		 / 1000000ULL);
+  if (evCnt < 1)
+    evCnt = 1;
+  if (evCnt > 31)
+    evCnt = 31;
+  if (evCnt != bd->evCount)
+    c775IntSetThreshold(ctx, id, evCnt);
+}
+
+/*******************************************************************************
+*
+* c775Int - default interrupt handler
+*
+* This rountine handles the c775 TDC interrupts.  arg holds the context
+* and the id of the interrupting TDC (C775_INT_ARG; C775_INT_ANY: the TDC
+* given to c775IntEnable).  The
+* user routine of that TDC is called, if one was connected by
+* c775IntConnect() or c775IntConnectBoard().  Otherwise the TDC is drained
+* into the interrupt readout ring, if one was set up (c775IntRingInit),
+* handed to the application through the interrupt eventfd, if there is
+* one (c775IntEventFd), or its events are thrown away.
+*
+* RETURNS: N/A
+*
+*/
+//FIXME SKIPPED
+LOCAL void
+c775Int(int arg)
+{
+  int ii = 0, id;
+  UINT32 nevt = 0;
+  c775_ctx *ctx;
+  c775_intstate *bd;
+
+  ctx = c775CtxTable[(arg >> 8) & (C775_MAX_CTX - 1)];
+  if (ctx == NULL)
+    {
+      logMsg("c775Int: ERROR : No context for interrupt arg 0x%x \n", arg, 0,
+	     0, 0, 0, 0);
+      return;
+    }
+  id = arg & 0xff;
+  if (id == C775_INT_ANY)
+    id = ctx->intID;
+
+  /* Disable interrupts */
+#ifdef VXWORKS
+  sysIntDisable(ctx->intLevel);
+#endif
+
+  ctx->intCount++;
+
+#ifndef VXWORKS
+  vmeBusLock();
+#endif
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Int: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      goto ENABLE;
+    }
+  bd = &ctx->intBd[id];
+  bd->count++;
+
+  if (bd->routine != NULL)
+    {				/* call user routine */
+      (*bd->routine) (bd->arg);
+    }
+  else if (ctx->ring.nslots > 0)
+    {
+      nevt = c775IntRingFill(ctx, id);
+    }
+#ifndef VXWORKS
+  else if (ctx->intFd >= 0)
+    {
+      /* Hand the TDC to the application: hold it off until it has been
+         read (c775IntRearm) */
+      C775LOCK(id);
+      C775_WRITE(id, evTrigger, 0);
+      C775UNLOCK(id);
+      __atomic_fetch_or(&ctx->intFdPending, 1u << id, __ATOMIC_SEQ_CST);
+      c775IntFdSignal(ctx);
+    }
+#endif
+  else
+    {
+      /* Default action is to increment the Read pointer by
+         the number of events in the Event Trigger register
+         or until the Data buffer is empty. The later case would
+         indicate a possible error. In either case the data is
+         effectively thrown away */
+      C775LOCK(id);
+      nevt = ctx->shadow[id].evTrigger & C775_EVTRIGGER_MASK;
+      C775UNLOCK(id);
+      while ((ii < nevt) && (c775CtxDready(ctx, id) > 0))
+	{
+	  C775LOCK(id);
+	  C775_EXEC_INCR_EVENT(id);
+	  C775UNLOCK(id);
+	  ii++;
+	}
+      if (ii < nevt)
+	logMsg
+	  ("c775Int: WARN : TDC %d - Events dumped (%d) != Events Triggered (%d)\n",
+	   id, ii, nevt, 0, 0, 0);
+      logMsg("c775Int: Processed %d events\n", nevt, 0, 0, 0, 0, 0);
+
+    }
+
+  if (bd->enabled)
+    c775IntAdapt(ctx, id, nevt);
+
+ENABLE:
+  /* Enable interrupts */
+#ifdef VXWORKS
+  sysIntEnable(ctx->intLevel);
+#else
+  vmeBusUnlock();
+#endif
+
+
+}
+
+
+/*******************************************************************************
+*
+* c775CtxIntConnect - connect a user routine to the c775 TDC interrupt
+*
+* This routine specifies the user interrupt routine to be called at each
+* interrupt. 
+*
+* RETURNS: OK, or ERROR if Interrupts are enabled
+*/
+//FIXME SKIPPED
+
+STATUS
+c775CtxIntConnect(c775_ctx * ctx, VOIDFUNCPTR routine, int arg, UINT16 level,
+		  UINT16 vector)
+{
+
+  if (ctx->intRunning)
+    {
+      printf
+	("c775IntConnect: ERROR : Interrupts already Initialized for TDC id %d\n",
+	 ctx->intID);
+      return (ERROR);
+    }
+
+  ctx->intRoutine = routine;
+  ctx->intArg = arg;
+
+  /* Check for user defined VME interrupt level and vector */
+  if (level == 0)
+    {
+      ctx->intLevel = C775_VME_INT_LEVEL;	/* use default */
+    }
+  else if (level > 7)
+    {
+      printf
+	("c775IntConnect: ERROR: Invalid VME interrupt level (%d). Must be (1-7)\n",
+	 level);
+      return (ERROR);
+    }
+  else
+    {
+      ctx->intLevel = level;
+    }
+
+  if (vector == 0)
+    {
+      ctx->intVec = C775_INT_VEC;	/* use default */
+    }
+  else if ((vector < 32) || (vector > 255))
+    {
+      printf
+	("c775IntConnect: ERROR: Invalid interrupt vector (%d). Must be (32<vector<255)\n",
+	 vector);
+      return (ERROR);
+    }
+  else
+    {
+      ctx->intVec = vector;
+    }
+
+  /* Connect the ISR */
+#ifdef VXWORKSPPC
+  if ((intDisconnect((int) INUM_TO_IVEC(ctx->intVec)) != 0))
+    {
+      printf("c775IntConnect: ERROR disconnecting Interrupt\n");
+      return (ERROR);
+    }
+#endif
+#ifdef VXWORKS
+  if ((intConnect(INUM_TO_IVEC(ctx->intVec), c775Int,
+		  C775_INT_ARG(ctx, C775_INT_ANY))) != 0)
+    {
+      printf("c775IntConnect: ERROR in intConnect()\n");
+      return (ERROR);
+    }
+#else
+  if (vmeIntDisconnect(ctx->intLevel) != 0)
+    {
+      printf("c775IntConnect: ERROR disconnecting Interrupt\n");
+      return (ERROR);
+    }
+  if (vmeIntConnect(ctx->intVec, ctx->intLevel, c775Int,
+		    C775_INT_ARG(ctx, C775_INT_ANY)) != 0)
+    {
+      printf("c775IntConnect: ERROR in intConnect()\n");
+      return (ERROR);
+    }
+#endif
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntConnectBoard - connect a user routine to the interrupt of one TDC
+*
+* Every TDC can interrupt with its own vector, so that only the TDCs with
+* data are read.  The interrupt level is shared by all TDCs.  Without a
+* user routine the TDC is drained into the interrupt readout ring
+* (c775IntRingInit), the shared queue of all TDCs.
+*
+* INPUTS:    id      - module id of TDC
+*            routine - user routine, called with arg, or NULL
+*            arg     - argument of the user routine
+*            level   - VME interrupt level (1-7) of all TDCs, 0 to keep
+*                      the current one
+*            vector  - interrupt vector of this TDC (32-255),
+*                      0 for C775_INT_VEC + id
+*
+* RETURNS: OK, or ERROR if the TDC is not available, interrupts are
+*          enabled on it, or a parameter is out of range.
+*/
+
+STATUS
+c775CtxIntConnectBoard(c775_ctx * ctx, int id, VOIDFUNCPTR routine, int arg,
+		       UINT16 level, UINT16 vector)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      printf("c775IntConnectBoard: ERROR : TDC id %d not initialized \n", id);
+      return (ERROR);
+    }
+
+  if (ctx->intBd[id].enabled)
+    {
+      printf("c775IntConnectBoard: ERROR : Interrupts enabled on TDC id %d\n",
+	     id);
+      return (ERROR);
+    }
+
+  if (level > 7)
+    {
+      printf
+	("c775IntConnectBoard: ERROR: Invalid VME interrupt level (%d). Must be (1-7)\n",
+	 level);
+      return (ERROR);
+    }
+  if (level != 0)
+    {
+      if (ctx->intRunning && (level != ctx->intLevel))
+	{
+	  printf
+	    ("c775IntConnectBoard: ERROR: Interrupts running on level %d\n",
+	     ctx->intLevel);
+	  return (ERROR);
+	}
+      ctx->intLevel = level;
+    }
+  else if (ctx->intLevel == 0)
+    ctx->intLevel = C775_VME_INT_LEVEL;	/* use default */
+
+  if (vector == 0)
+    vector = C775_INT_VEC + id;	/* use default */
+  if ((vector < 32) || (vector > 255))
+    {
+      printf
+	("c775IntConnectBoard: ERROR: Invalid interrupt vector (%d). Must be (32<vector<255)\n",
+	 vector);
+      return (ERROR);
+    }
+
+  /* Connect the ISR, with the TDC id as argument */
+#ifdef VXWORKS
+  if ((intConnect(INUM_TO_IVEC(vector), c775Int, C775_INT_ARG(ctx, id))) != 0)
+    {
+      printf("c775IntConnectBoard: ERROR in intConnect()\n");
+      return (ERROR);
+    }
+#else
+  if (vmeIntConnect(vector, ctx->intLevel, c775Int, C775_INT_ARG(ctx, id)) != 0)
+    {
+      printf("c775IntConnectBoard: ERROR in intConnect()\n");
+      return (ERROR);
+    }
+#endif
+
+  ctx->intBd[id].vector = vector;
+  ctx->intBd[id].routine = routine;
+  ctx->intBd[id].arg = arg;
+
+  return (OK);
+}
+
+
+
+/* Zero the TDC's interrupt counters, set the Running Flag and enable
+   interrupts on the TDC */
+LOCAL void
+c775IntArm(c775_ctx * ctx, int id, int evCnt)
+{
+  c775_intstate *bd = &ctx->intBd[id];
+
+#ifdef VXWORKS
+  sysIntEnable(ctx->intLevel);	/* Enable VME interrupts */
+#endif
+
+  bd->evCount = evCnt;
+  bd->count = 0;
+  bd->evRate = 0;
+  bd->rate = 0;
+  bd->flushes = 0;
+  bd->last = bd->winStart = c775Now();
+  bd->winCount = 0;
+  bd->enabled = 1;
+  ctx->intRunning = TRUE;
+
+  C775LOCK(id);
+  C775_WRITE(id, intVector, bd->vector);
+  C775_WRITE(id, intLevel, ctx->intLevel);
+  C775_WRITE(id, evTrigger, evCnt);
+  C775UNLOCK(id);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntEnable - Enable interrupts from specified TDC
+*
+* Enables interrupts for a specified TDC.
+* 
+* RETURNS OK or ERROR if TDC is not available or parameter is out of range
+*/
+
+STATUS
+c775CtxIntEnable(c775_ctx * ctx, int id, UINT16 evCnt)
+{
+
+  if (ctx->intRunning)
+    {
+      printf
+	("c775IntEnable: ERROR : Interrupts already initialized for TDC id %d\n",
+	 ctx->intID);
+      return (ERROR);
+    }
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      printf("c775IntEnable: ERROR : TDC id %d not initialized \n", id);
+      return (ERROR);
+    }
+  else
+    {
+      ctx->intID = id;
+    }
+
+  /* check for event count out of range */
+  if ((evCnt <= 0) || (evCnt > 31))
+    {
+      printf
+	("c775IntEnable: ERROR: Event count %d for Interrupt is out of range (1-31)\n",
+	 evCnt);
+      return (ERROR);
+    }
+
+  ctx->intBd[id].vector = ctx->intVec;
+  ctx->intBd[id].routine = ctx->intRoutine;
+  ctx->intBd[id].arg = ctx->intArg;
+  ctx->intCount = 0;
+  c775IntArm(ctx, id, evCnt);
+
+  return (OK);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxIntDisable - disable the TDC interrupts
+*
+* RETURNS: OK, or ERROR if not initialized
+*/
+
+STATUS
+c775CtxIntDisable(c775_ctx * ctx, int iflag)
+{
+
+  if ((ctx->intID < 0) || (ctx->p[ctx->intID] == NULL))
+    {
+      logMsg("c775IntDisable: ERROR : TDC id %d not initialized \n",
+	     ctx->intID, 0, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+#ifdef VXWORKS
+  sysIntDisable(ctx->intLevel);	/* Disable VME interrupts */
+#endif
+  C775LOCK(ctx->intID);
+  C775_WRITE(ctx->intID, evTrigger, 0);
+
+  /* Tell tasks that Interrupts have been disabled */
+  if (iflag > 0)
+    {
+      ctx->intRunning = FALSE;
+      ctx->intBd[ctx->intID].enabled = 0;
+      C775_WRITE(ctx->intID, intLevel, 0);
+      C775_WRITE(ctx->intID, intVector, 0);
+    }
+#ifdef VXWORKS
+  else
+    {
+      semGive(ctx->sem);
+    }
+#endif
+
+  C775UNLOCK(ctx->intID);
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntEnableBoard - Enable interrupts from one TDC, connected with
+*                       c775IntConnectBoard.  Other TDCs keep interrupting.
+* c775CtxIntDisableBoard - Disable interrupts from one TDC.
+*
+* INPUTS:    id    - module id of TDC
+*            evCnt - number of events to generate an interrupt (1-31)
+*
+* RETURNS: OK, or ERROR if the TDC is not available or not connected, or
+*          the event count is out of range.
+*/
+
+STATUS
+c775CtxIntEnableBoard(c775_ctx * ctx, int id, UINT16 evCnt)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      printf("c775IntEnableBoard: ERROR : TDC id %d not initialized \n", id);
+      return (ERROR);
+    }
+
+  if (ctx->intBd[id].vector == 0)
+    {
+      printf("c775IntEnableBoard: ERROR : TDC id %d not connected \n", id);
+      return (ERROR);
+    }
+
+  if ((evCnt <= 0) || (evCnt > 31))
+    {
+      printf
+	("c775IntEnableBoard: ERROR: Event count %d for Interrupt is out of range (1-31)\n",
+	 evCnt);
+      return (ERROR);
+    }
+
+  c775IntArm(ctx, id, evCnt);
+
+  return (OK);
+}
+
+STATUS
+c775CtxIntDisableBoard(c775_ctx * ctx, int id)
+{
+  int ii;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775IntDisableBoard: ERROR : TDC id %d not initialized \n", id,
+	     0, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  C775_WRITE(id, evTrigger, 0);
+  C775_WRITE(id, intLevel, 0);
+  C775_WRITE(id, intVector, 0);
+  ctx->intBd[id].enabled = 0;
+  C775UNLOCK(id);
+
+  ctx->intRunning = FALSE;
+  for (ii = 0; ii < ctx->nboards; ii++)
+    if (ctx->intBd[ii].enabled)
+      ctx->intRunning = TRUE;
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntRearm - Re-enable the interrupt of a TDC held off by the handler
+*                (full readout ring, or c775IntEventFd hand-off), with its
+*                current event threshold.
+*
+* RETURNS: OK, or ERROR if interrupts are not enabled on the TDC.
+*/
+
+STATUS
+c775CtxIntRearm(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL)
+      || !ctx->intBd[id].enabled)
+    {
+      logMsg("c775IntRearm: ERROR : Interrupts not enabled on TDC id %d\n",
+	     id, 0, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  C775_WRITE(id, evTrigger, ctx->intBd[id].evCount);
+  C775UNLOCK(id);
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntResume - Re-enable interrupts from previously 
+*                 intitialized TDC
+*
+* RETURNS: OK, or ERROR if not initialized
+*/
+
+STATUS
+c775CtxIntResume(c775_ctx * ctx)
+{
+  UINT16 evTrig = 0;
+
+  if ((ctx->intID < 0) || (ctx->p[ctx->intID] == NULL))
+    {
+      logMsg("c775IntResume: ERROR : TDC id %d not initialized \n", ctx->intID,
+	     0, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(ctx->intID);
+  if ((ctx->intRunning))
+    {
+      evTrig = ctx->shadow[ctx->intID].evTrigger & C775_EVTRIGGER_MASK;
+      if (evTrig == 0)
+	{
+#ifdef VXWORKS
+	  sysIntEnable(ctx->intLevel);
+#endif
+	  C775_WRITE(ctx->intID, evTrigger, ctx->intBd[ctx->intID].evCount);
+	}
+      else
+	{
+	  logMsg("c775IntResume: WARNING : Interrupts already enabled \n", 0,
+		 0, 0, 0, 0, 0);
+	  C775UNLOCK(ctx->intID);
+	  return (ERROR);
+	}
+    }
+  else
+    {
+      logMsg("c775IntResume: ERROR : Interrupts are not Enabled \n", 0, 0, 0,
+	     0, 0, 0);
+      C775UNLOCK(ctx->intID);
+      return (ERROR);
+    }
+
+  C775UNLOCK(ctx->intID);
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntSetAdaptive - Let the event threshold for interrupts follow the
+*                      trigger rate.
+*
+*    At each interrupt the trigger rate of the TDC is estimated from the
+*    time since its previous one, and its evTrigger is set to the number
+*    of triggers expected within the latency ceiling (1 - 31): few, large
+*    interrupts at high rate, one per event at low rate.  The ceiling
+*    applies to every interrupting TDC.
+*
+*    When the rate drops, events can wait for a threshold that is no
+*    longer reached.  c775IntAdaptCheck, called at least once per latency
+*    ceiling by the readout thread (c775IntRingWait does), lowers the
+*    threshold to 1 on the TDCs that hold events.
+*
+* INPUTS:    latency - latency ceiling in microseconds,
+*                      0 to keep the threshold given to c775IntEnable
+*
+* RETURNS: OK, or ERROR if the latency is negative.
+*/
+
+STATUS
+c775CtxIntSetAdaptive(c775_ctx * ctx, int latency)
+{
+  int ii;
+
+  if (latency < 0)
+    {
+      printf("c775IntSetAdaptive: ERROR: Invalid latency ceiling (%d us)\n",
+	     latency);
+      return (ERROR);
+    }
+
+  ctx->intLatency = latency;
+  for (ii = 0; ii < ctx->maxBoards; ii++)
+    ctx->intBd[ii].evRate = 0;
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntAdaptCheck - Enforce the latency ceiling of adaptive interrupts:
+*                     on every interrupting TDC that holds events which
+*                     have not reached its threshold, drop the threshold
+*                     to 1 so they interrupt now.
+*
+* RETURNS: Number of thresholds dropped, or ERROR if interrupts are not
+*          running.
+*/
+
+int
+c775CtxIntAdaptCheck(c775_ctx * ctx)
+{
+  int id, nflush = 0;
+
+  if (!ctx->intRunning)
+    return (ERROR);
+  if (ctx->intLatency <= 0)
+    return (0);
+
+  for (id = 0; id < ctx->nboards; id++)
+    {
+      if (!ctx->intBd[id].enabled || (ctx->intBd[id].evCount <= 1))
+	continue;
+      if (c775CtxDreadyFast(ctx, id) > 0)
+	{
+	  ctx->intBd[id].flushes++;
+	  ctx->intBd[id].evRate = 0;
+	  c775IntSetThreshold(ctx, id, 1);
+	  nflush++;
+	}
+    }
+
+  return (nflush);
+}
+
+/*******************************************************************************
+*
+* c775CtxIntGetStats - Return the interrupt statistics of a TDC
+*
+* RETURNS: OK, or ERROR if the TDC is not available.
+*/
+
+STATUS
+c775CtxIntGetStats(c775_ctx * ctx, int id, c775_intstats * stats)
+{
+  c775_intstate *bd;
+  unsigned long long now = c775Now();
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775IntGetStats: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  bd = &ctx->intBd[id];
+  stats->count = bd->count;
+  stats->irqRate = bd->rate;
+  /* No interrupt for a while: the rate has dropped */
+  if (bd->enabled && (now - bd->winStart > 2000000ULL))
+    stats->irqRate = (unsigned int) ((bd->winCount * 1000000ULL)
+				     / (now - bd->winStart));
+  stats->evRate = bd->evRate;
+  stats->evTrigger = bd->evCount;
+  stats->latency = ctx->intLatency;
+  stats->flushes = bd->flushes;
+
+  return (OK);
+}
+
+
+
+
+/*******************************************************************************
+*
+* c775CtxSparse - Enable/Disable Overflow and Under threshold sparsification
+*
+*
+* RETURNS: Bit Set 2 Register value (as written, see c775Verify).
+*/
+
+UINT16
+c775CtxSparse(c775_ctx * ctx, int id, int over, int under)
+{
+  UINT16 rval;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      printf("c775Sparse: ERROR : TDC id %d not initialized \n", id);
+      return (0xffff);
+    }
+
+  C775LOCK(id);
+  if (!over)
+    {				/* Set Overflow suppression */
+      C775_BITSET2(id, C775_OVER_RANGE);
+    }
+  else
+    {
+      C775_BITCLEAR2(id, C775_OVER_RANGE);
+    }
+
+  if (!under)
+    {				/* Set Underflow suppression */
+      C775_BITSET2(id, C775_LOW_THRESHOLD);
+    }
+  else
+    {
+      C775_BITCLEAR2(id, C775_LOW_THRESHOLD);
+    }
+  rval = ctx->shadow[id].bitSet2 & C775_BITSET2_MASK;
+
+  C775UNLOCK(id);
+  return (rval);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxDready - Return status of Data Ready bit in TDC
+*
+*
+* RETURNS: 0(No Data) or  # of events in FIFO (1-32) or ERROR.
+*/
+
+int
+c775CtxDready(c775_ctx * ctx, int id)
+{
+
+  int nevts = 0;
+  UINT16 stat = 0;
+
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Dready: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  stat = vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY;
+  if (stat)
+    {
+      C775_EXEC_READ_EVENT_COUNT(id);
+      nevts = ctx->state[id].eventCount - ctx->state[id].evtReadCnt;
+      if (nevts <= 0)
+	{
+	  logMsg("c775Dready: ERROR : Bad Event Ready Count (nevts = %d)\n",
+		 nevts, 0, 0, 0, 0, 0);
+	  C775UNLOCK(id);
+	  return (ERROR);
+	}
+    }
+
+  C775UNLOCK(id);
+  return (nevts);
+}
+
+/*******************************************************************************
+*
+* c775CtxDreadyFast - Return the number of events ready in the TDC, with as few
+*                  VME cycles as possible.
+*
+*    Events seen ready by an earlier call and not read yet are returned
+*    without going to the bus.  Otherwise the 24 bit Event Counter
+*    (evCountL/evCountH, adjacent registers) is read with one D32 cycle,
+*    and status1 is read only when the counter has moved, to make sure the
+*    new events have reached the output buffer.  Where the bridge does not
+*    take D32 cycles on these D16 registers (checked by c775Init and
+*    c775Discover) the counter is read with two D16 cycles.
+*
+*    Bus cycles: 0 with events pending, 1 when there is nothing new,
+*    2 when there is (c775Dready: 1 and 3), one more each without D32.
+*
+*    The count is only dropped by the read functions that know what they
+*    took: use c775ReadEvent or c775ReadEvents to profit from it.
+*
+* RETURNS: 0(No Data) or # of events in FIFO (1-32) or ERROR.
+*/
+
+int
+c775CtxDreadyFast(c775_ctx * ctx, int id)
+{
+  return (c775CtxDreadyMin(ctx, id, 1));
+}
+
+/*******************************************************************************
+*
+* c775CtxDreadyMin - Return the number of events ready in the TDC, as
+*                    c775DreadyFast, for a caller waiting for nmin of them:
+*                    the Event Counter is read again as long as fewer than
+*                    nmin events are pending.
+*
+* INPUTS:    id   - TDC id
+*            nmin - events wanted (e.g. a block)
+*
+* RETURNS: 0(No Data) or # of events in FIFO (1-32) or ERROR.
+*/
+
+int
+c775CtxDreadyMin(c775_ctx * ctx, int id, int nmin)
+{
+  int nevts, pending;
+  UINT32 cnt;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775DreadyFast: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  pending = C775_EVPENDING(id);
+  if (pending < 0)
+    pending = 0;
+  if ((pending > 0) && (pending >= nmin))
+    {
+      C775UNLOCK(id);
+      return (pending);
+    }
+
+  if (ctx->state[id].d32Count)
+    {
+      /* Big endian bus: evCountL in the upper half, evCountH below */
+      cnt = vmeRead32((volatile UINT32 *) &ctx->p[id]->main.evCountL);
+      cnt = ((cnt & 0xff) << 16) | (cnt >> 16);
+    }
+  else
+    {
+      cnt = vmeRead16(&ctx->p[id]->main.evCountL);
+      cnt |= (vmeRead16(&ctx->p[id]->main.evCountH) & 0xff) << 16;
+    }
+  nevts = C775_EVDIFF(cnt, ctx->state[id].evtReadCnt);
+  if ((nevts > pending)
+      && (vmeRead16(&ctx->p[id]->main.status1) & C775_DATA_READY))
+    {
+      ctx->state[id].eventCount = (ctx->state[id].eventCount & 0xff000000) + cnt;
+      ctx->state[id].evReady = cnt;
+      if (nevts > C775_MAX_EVENTS)
+	{
+	  logMsg("c775DreadyFast: ERROR : Bad Event Ready Count (nevts = %d)\n",
+		 nevts, 0, 0, 0, 0, 0);
+	  C775_EXEC_FORGET_READY(id);
+	  C775UNLOCK(id);
+	  return (ERROR);
+	}
+    }
+  else
+    nevts = pending;
+
+  C775UNLOCK(id);
+  return (nevts);
+}
+
+/*******************************************************************************
+*
+* c775GetBusCycles - Return the number of VME cycles made by the library
+*                    for the calling thread.  Every D16/D32 single cycle
+*                    and every DMA counts one.  The cost of a call is the
+*                    difference of two readings around it.
+*
+* RETURNS: Running count of bus cycles (wraps at 2^32).
+*/
+
+unsigned int
+c775GetBusCycles(void)
+{
+  return (c775BusCycles);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxSetFSR - Set and/or Return TDC full scale range programming
+*
+*      Register value:    0xff (255) ->  35 ps/count  (  140ns FSR )
+*       range between:    0x1e ( 30) -> 300 ps/count  ( 1200ns FSR )
+*
+*        FSR = 4*(290-reg)
+*
+*        reg = 290 - FSR/4
+*
+*      Note: Passing 0 for fsr will return the contents of the register
+*            (as last written, see c775Verify) but not set it.
+*
+* RETURNS: Full scale range of the TDC in nanoseconds or ERROR.
+*/
+
+int
+c775CtxSetFSR(c775_ctx * ctx, int id, UINT16 fsr)
+{
+
+  int rfsr = 0;
+  UINT16 reg;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775SetFSR: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  if (fsr == 0)
+    {
+      reg = ctx->shadow[id].fsr & C775_FSR_MASK;
+      rfsr = (int) (290 - reg) * 4;
+    }
+  else if ((fsr < C775_MIN_FSR) || (fsr > C775_MAX_FSR))
+    {
+      logMsg("c775SetFSR: ERROR: FSR (%d ns) out of range (140<=FSR<=1200)\n",
+	     fsr, 0, 0, 0, 0, 0);
+      C775UNLOCK(id);
+      return (ERROR);
+    }
+  else
+    {
+      reg = (UINT16) (290 - (fsr >> 2));
+      C775_WRITE(id, fsr, reg);
+      rfsr = (int) (290 - (reg & C775_FSR_MASK)) * 4;
+    }
+
+  C775UNLOCK(id);
+  return (rfsr);
+
+}
+
+/******************************************************************************
+ *
+ *
+ * c775BitSet2      - Program Bit Set 2 register
+ * c775BitClear2    - Program Bit clear 2 register
+ *
+ *    Both return the Bit Set 2 register as written (see c775Verify).
+ *
+ */
+
+INT16
+c775CtxBitSet2(c775_ctx * ctx, int id, UINT16 val)
+{
+  INT16 rval;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775BitSet2: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  if (val)
+    C775_BITSET2(id, val);
+  rval = ctx->shadow[id].bitSet2 & C775_BITSET2_MASK;
+
+  C775UNLOCK(id);
+  return (rval);
+}
+
+INT16
+c775CtxBitClear2(c775_ctx * ctx, int id, UINT16 val)
+{
+  INT16 rval;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775BitClear2: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  if (val)
+    C775_BITCLEAR2(id, val);
+  rval = ctx->shadow[id].bitSet2 & C775_BITSET2_MASK;
+
+  C775UNLOCK(id);
+  return (rval);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxGetShadow - Copy the configuration registers of a TDC, as last
+*                    written by the library, without touching the bus
+*
+* RETURNS: OK, or ERROR if the TDC is not initialized.
+*/
+
+STATUS
+c775CtxGetShadow(c775_ctx * ctx, int id, c775_shadow * regs)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775GetShadow: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  *regs = ctx->shadow[id];
+  C775UNLOCK(id);
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775CtxVerify - Read back the configuration registers of a TDC and compare
+*                 them with the values written by the library
+*
+*    The TDC is read, not changed, and neither is the shadow: a register
+*    written behind the library's back stays different until it is set
+*    again through the library (or the TDC is reset).
+*
+* INPUTS:    id    - TDC id
+*            pflag - 1 to print each register that differs
+*
+* RETURNS: Number of registers that differ, or ERROR.
+*/
+
+int
+c775CtxVerify(c775_ctx * ctx, int id, int pflag)
+{
+  int ii, nbad = 0;
+  UINT16 hw, sw;
+  volatile UINT16 *reg;
+  c775_shadow *sh;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Verify: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return (ERROR);
+    }
+
+  sh = &ctx->shadow[id];
+  C775LOCK(id);
+  for (ii = 0; ii < (int) (sizeof(c775ShadowRegs) / sizeof(c775ShadowRegs[0]));
+       ii++)
+    {
+      reg = (volatile UINT16 *) ((char *) &ctx->p[id]->main
+				 + c775ShadowRegs[ii].reg);
+      hw = vmeRead16(reg) & c775ShadowRegs[ii].mask;
+      sw = *(UINT16 *) ((char *) sh + c775ShadowRegs[ii].shadow)
+	& c775ShadowRegs[ii].mask;
+      if (hw != sw)
+	{
+	  nbad++;
+	  if (pflag)
+	    printf("c775Verify: TDC %d %-12s 0x%04x (expected 0x%04x)\n", id,
+		   c775ShadowRegs[ii].name, hw, sw);
+	}
+    }
+  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+    {
+      hw = vmeRead16(&ctx->p[id]->main.threshold[ii]) & C775_THRESHOLD_MASK;
+      sw = sh->threshold[ii] & C775_THRESHOLD_MASK;
+      if (hw != sw)
+	{
+	  nbad++;
+	  if (pflag)
+	    printf("c775Verify: TDC %d threshold[%2d] 0x%04x (expected 0x%04x)\n",
+		   id, ii, hw, sw);
+	}
+    }
+  C775UNLOCK(id);
+
+  return (nbad);
+}
+
+
+/*******************************************************************************
+*
+* c775ConfigDefault - Fill a configuration with the setup of c775Init
+*
+*    FSR 140 ns, no Overflow/Underflow suppression, Common Start, zero
+*    thresholds, Crate ID 0, default interrupt level and vector, one
+*    event per interrupt.
+*
+* RETURNS: None.
+*/
+
+void
+c775ConfigDefault(c775_config * cfg)
+{
+  int id;
+
+  memset(cfg, 0, sizeof(c775_config));
+  cfg->intEvents = 1;
+  for (id = 0; id < C775_CTX_MAX_BOARDS; id++)
+    cfg->board[id].fsr = C775_MIN_FSR;
+}
+
+/* One setting of the configuration file, for board id (-1: every board).
+   Returns OK, or ERROR for an unknown key or a bad value. */
+LOCAL STATUS
+c775ConfigSet(c775_config * cfg, int id, const char *key, char *args)
+{
+  char *tok, *end, *save;
+  unsigned long val[C775_MAX_CHANNELS];
+  int nval = 0, ii, first, last;
+
+  for (tok = strtok_r(args, " \t\r\n", &save); tok != NULL;
+       tok = strtok_r(NULL, " \t\r\n", &save))
+    {
+      if ((tok[0] == '#') || (nval == C775_MAX_CHANNELS))
+	break;
+      val[nval++] = strtoul(tok, &end, 0);
+      if (*end != '\0')
+	return (ERROR);
+    }
+  if (nval == 0)
+    return (ERROR);
+
+  if (strcmp(key, "CRATE_ID") == 0)
+    {
+      if ((id >= 0) || (val[0] > 0xff))
+	return (ERROR);
+      cfg->crateID = val[0];
+      return (OK);
+    }
+  if (strcmp(key, "INT_LEVEL") == 0)
+    {
+      if ((id >= 0) || (val[0] > 7))
+	return (ERROR);
+      cfg->intLevel = val[0];
+      return (OK);
+    }
+  if (strcmp(key, "INT_VECTOR") == 0)
+    {
+      if ((id >= 0) || ((val[0] != 0) && ((val[0] < 32) || (val[0] > 255))))
+	return (ERROR);
+      cfg->intVector = val[0];
+      return (OK);
+    }
+  if (strcmp(key, "INT_EVENTS") == 0)
+    {
+      if ((id >= 0) || (val[0] < 1) || (val[0] > C775_EVTRIGGER_MASK))
+	return (ERROR);
+      cfg->intEvents = val[0];
+      return (OK);
+    }
+
+  first = (id < 0) ? 0 : id;
+  last = (id < 0) ? C775_CTX_MAX_BOARDS - 1 : id;
+  for (id = first; id <= last; id++)
+    {
+      c775_boardcfg *bd = &cfg->board[id];
+
+      if (strcmp(key, "FSR") == 0)
+	{
+	  if ((val[0] < C775_MIN_FSR) || (val[0] > C775_MAX_FSR))
+	    return (ERROR);
+	  bd->fsr = val[0];
+	}
+      else if (strcmp(key, "SUPPRESS_OVER") == 0)
+	bd->suppressOver = (val[0] != 0);
+      else if (strcmp(key, "SUPPRESS_UNDER") == 0)
+	bd->suppressUnder = (val[0] != 0);
+      else if (strcmp(key, "COMMON_STOP") == 0)
+	bd->commonStop = (val[0] != 0);
+      else if (strcmp(key, "THRESHOLD") == 0)
+	{
+	  /* THRESHOLD <channel> <value> */
+	  if ((nval != 2) || (val[0] >= C775_MAX_CHANNELS)
+	      || (val[1] > C775_THRESHOLD_MASK))
+	    return (ERROR);
+	  bd->threshold[val[0]] = val[1];
+	}
+      else if (strcmp(key, "THRESHOLDS") == 0)
+	{
+	  /* THRESHOLDS <value of channel 0> ... <value of channel 31> */
+	  if (nval != C775_MAX_CHANNELS)
+	    return (ERROR);
+	  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+	    {
+	      if (val[ii] > C775_THRESHOLD_MASK)
+		return (ERROR);
+	      bd->threshold[ii] = val[ii];
+	    }
+	}
+      else
+	return (ERROR);
+    }
+
+  return (OK);
+}
+
+/*******************************************************************************
+*
+* c775ConfigLoad - Read a configuration file
+*
+*    One setting per line, "KEY value(s)", '#' starts a comment.  Settings
+*    of the TDCs placed before the first BOARD line are given to every
+*    TDC; "BOARD <id>" starts the settings of that TDC only.
+*
+*      CRATE_ID       <0-255>
+*      INT_LEVEL      <1-7, 0: default>     (for c775IntConnect)
+*      INT_VECTOR     <32-255, 0: default>  (for c775IntConnect)
+*      INT_EVENTS     <1-31>                (for c775IntEnable)
+*      BOARD          <id>
+*      FSR            <140-1200 ns>
+*      SUPPRESS_OVER  <0|1>    suppress Overflow hits
+*      SUPPRESS_UNDER <0|1>    suppress hits under threshold
+*      COMMON_STOP    <0|1>    1: Common Stop, 0: Common Start
+*      THRESHOLD      <channel> <register value>
+*      THRESHOLDS     <32 register values, channel 0 first>
+*
+*    Anything not in the file keeps the value of c775ConfigDefault.
+*    Nothing is written to the TDCs (c775ConfigApply).
+*
+* RETURNS: OK, or ERROR if the file cannot be read or has an error.
+*/
+
+STATUS
+c775ConfigLoad(const char *filename, c775_config * cfg)
+{
+  FILE *fp;
+  char line[512], key[32], *args;
+  int lineno = 0, id = -1, n;
+  unsigned long bd;
+  STATUS rval = OK;
+
+  fp = fopen(filename, "r");
+  if (fp == NULL)
+    {
+      printf("c775ConfigLoad: ERROR: Unable to open %s\n", filename);
+      return (ERROR);
+    }
+
+  c775ConfigDefault(cfg);
+  while (fgets(line, sizeof(line), fp) != NULL)
+    {
+      lineno++;
+      if ((sscanf(line, " %31s%n", key, &n) != 1) || (key[0] == '#'))
+	continue;
+      args = line + n;
+
+      if (strcmp(key, "BOARD") == 0)
+	{
+	  bd = strtoul(args, &args, 0);
+	  if ((bd >= C775_CTX_MAX_BOARDS) || (args == line + n))
+	    rval = ERROR;
+	  else
+	    id = bd;
+	}
+      else
+	rval = c775ConfigSet(cfg, id, key, args);
+
+      if (rval != OK)
+	{
+	  printf("c775ConfigLoad: ERROR: %s:%d: Invalid setting \"%s\"\n",
+		 filename, lineno, key);
+	  break;
+	}
+    }
+  fclose(fp);
+
+  return (rval);
+}
+
+/* Write the thresholds of a TDC that differ from its shadow (TDC locked).
+   Returns the number of registers written. */
+LOCAL int
+c775ThreshWrite(c775_ctx * ctx, int id, const UINT16 * thr)
+{
+  int ii, nwrite = 0;
+
+  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+    {
+      if (ctx->shadow[id].threshold[ii] != thr[ii])
+	{
+	  C775_WRITE(id, threshold[ii], thr[ii]);
+	  nwrite++;
+	}
+    }
+
+  return (nwrite);
+}
+
+/*******************************************************************************
+*
+* c775CtxConfigApply - Bring the TDCs to a configuration (c775ConfigLoad)
+*
+*    Every register is compared with the value last written to it (the
+*    shadow, c775GetShadow), and only those that differ are written.
+*    Applying the same configuration again at the next Prestart costs no
+*    bus cycles; after a reset everything is written again.
+*
+*    The interrupt settings are not written: they are for the
+*    c775IntConnect and c775IntEnable calls of the readout.
+*
+* RETURNS: Number of registers written, or ERROR.
+*/
+
+int
+c775CtxConfigApply(c775_ctx * ctx, const c775_config * cfg)
+{
+  int id, nwrite = 0;
+  UINT16 set2, clr2, reg;
+  const c775_boardcfg *bd;
+  c775_shadow *sh;
+
+  if (ctx->nboards == 0)
+    {
+      printf("c775ConfigApply: ERROR: No TDCs initialized\n");
+      return (ERROR);
+    }
+
+  for (id = 0; id < ctx->nboards; id++)
+    {
+      bd = &cfg->board[id];
+      sh = &ctx->shadow[id];
+      if ((bd->fsr < C775_MIN_FSR) || (bd->fsr > C775_MAX_FSR))
+	{
+	  printf("c775ConfigApply: ERROR: TDC %d: FSR (%d ns) out of range\n",
+		 id, bd->fsr);
+	  return (ERROR);
+	}
+
+      /* Bit Set 2: the bits kept when set disable the suppression */
+      set2 = clr2 = 0;
+      if (bd->suppressOver)
+	clr2 |= C775_OVER_RANGE;
+      else
+	set2 |= C775_OVER_RANGE;
+      if (bd->suppressUnder)
+	clr2 |= C775_LOW_THRESHOLD;
+      else
+	set2 |= C775_LOW_THRESHOLD;
+      if (bd->commonStop)
+	set2 |= C775_COMMON_STOP;
+      else
+	clr2 |= C775_COMMON_STOP;
+      set2 &= ~sh->bitSet2;
+      clr2 &= sh->bitSet2;
+      reg = (UINT16) (290 - (bd->fsr >> 2));
+
+      C775LOCK(id);
+      if (sh->crateSelect != cfg->crateID)
+	{
+	  C775_WRITE(id, crateSelect, cfg->crateID);
+	  nwrite++;
+	}
+      if (sh->fsr != reg)
+	{
+	  C775_WRITE(id, fsr, reg);
+	  nwrite++;
+	}
+      if (set2 != 0)
+	{
+	  C775_BITSET2(id, set2);
+	  nwrite++;
+	}
+      if (clr2 != 0)
+	{
+	  C775_BITCLEAR2(id, clr2);
+	  nwrite++;
+	}
+      nwrite += c775ThreshWrite(ctx, id, bd->threshold);
+      C775UNLOCK(id);
+    }
+
+  return (nwrite);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxSetThresholds    - Load the thresholds of the 32 channels of a TDC
+* c775CtxSetThresholdsAll - Load the thresholds of every TDC
+*
+*    Only the thresholds that differ from the values last written (the
+*    shadow) are written.  The threshold registers are D16 only, they
+*    cannot be block written: c775SetThresholdsAll instead writes a value
+*    that every TDC needs in a channel once, by MCST, when the chain is
+*    set up (c775MCSTInit).
+*
+* INPUTS:    thr - register value (threshold and kill bit) of each channel
+*                  (c775SetThresholdsAll: of each TDC, by id)
+*
+* RETURNS: Number of VME writes, or ERROR.
+*/
+
+int
+c775CtxSetThresholds(c775_ctx * ctx, int id,
+		     const UINT16 thr[C775_MAX_CHANNELS])
+{
+  int ii, nwrite;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775SetThresholds: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+    {
+      if (thr[ii] & ~C775_THRESHOLD_MASK)
+	{
+	  logMsg("c775SetThresholds: ERROR : Invalid threshold 0x%x (channel %d)\n",
+		 thr[ii], ii, 0, 0, 0, 0);
+	  return (ERROR);
+	}
+    }
+
+  C775LOCK(id);
+  nwrite = c775ThreshWrite(ctx, id, thr);
+  C775UNLOCK(id);
+
+  return (nwrite);
+}
+
+int
+c775CtxSetThresholdsAll(c775_ctx * ctx, const UINT16 thr[][C775_MAX_CHANNELS])
+{
+  int id, ii, same, stale, nwrite = 0;
+
+  for (id = 0; id < ctx->nboards; id++)
+    for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+      {
+	if (thr[id][ii] & ~C775_THRESHOLD_MASK)
+	  {
+	    logMsg("c775SetThresholdsAll: ERROR : Invalid threshold 0x%x"
+		   " (TDC %d channel %d)\n", thr[id][ii], id, ii, 0, 0, 0);
+	    return (ERROR);
+	  }
+      }
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+	{
+	  same = 1;
+	  stale = 0;
+	  for (id = 0; id < ctx->nboards; id++)
+	    {
+	      if (thr[id][ii] != thr[0][ii])
+		same = 0;
+	      if (ctx->shadow[id].threshold[ii] != thr[id][ii])
+		stale++;
+	    }
+	  if (!same || (stale < 2))
+	    continue;
+	  vmeWrite16(&ctx->cbltp->main.threshold[ii], thr[0][ii]);
+	  for (id = 0; id < ctx->nboards; id++)
+	    ctx->shadow[id].threshold[ii] = thr[0][ii];
+	  nwrite++;
+	}
+    }
+  for (id = 0; id < ctx->nboards; id++)
+    nwrite += c775ThreshWrite(ctx, id, thr[id]);
+  C775UNLOCK_ALL;
+
+  return (nwrite);
+}
+
+/*******************************************************************************
+*
+* c775CtxGetThresholds - Return the thresholds of the 32 channels of a TDC
+*
+*    Without verify the values last written are returned, with no bus
+*    cycles.  With verify the registers are read from the TDC.
+*
+* INPUTS:    thr    - filled with the register value of each channel
+*            verify - 1 to read the thresholds from the TDC
+*
+* RETURNS: Number of thresholds that differ from the values last written
+*          (0 without verify), or ERROR.
+*/
+
+int
+c775CtxGetThresholds(c775_ctx * ctx, int id, UINT16 thr[C775_MAX_CHANNELS],
+		     int verify)
+{
+  int ii, nbad = 0;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775GetThresholds: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  C775LOCK(id);
+  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+    {
+      if (verify)
+	{
+	  thr[ii] = vmeRead16(&ctx->p[id]->main.threshold[ii])
+	    & C775_THRESHOLD_MASK;
+	  if (thr[ii] != ctx->shadow[id].threshold[ii])
+	    nbad++;
+	}
+      else
+	thr[ii] = ctx->shadow[id].threshold[ii];
+    }
+  C775UNLOCK(id);
+
+  return (nbad);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxClearThresh  - Zero TDC thresholds for all channels
+* c775CtxGate         - Issue Software Gate to TDC
+* c775CtxEnableBerr   - Enable Bus Error termination of block reads
+* c775CtxDisableBerr  - Disable Bus Error termination of block reads
+* c775CtxIncrEventBlk - Increment Event counter for Block reads
+* c775CtxIncrEvent    - Increment Read pointer to next event in the Buffer
+* c775CtxIncrWord     - Increment Read pointer to next word in the event
+* c775CtxEnable       - Bring TDC Online (Enable Gates)
+* c775CtxDisable      - Bring TDC Offline (Disable Gates)
+* c775CtxCommonStop   - Program for Common Stop
+* c775CtxCommonStart  - Program for Common Start (Default)
+* c775CtxClear        - Clear TDC
+* c775CtxReset        - Clear/Reset TDC
+*
+*
+* RETURNS: None.
+*/
+
+void
+c775CtxClearThresh(c775_ctx * ctx, int id)
+{
+  int ii;
+
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775ClearThresh: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return;
+    }
+
+  C775LOCK(id);
+  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
+    {
+      C775_WRITE(id, threshold[ii], 0);
+    }
+  C775UNLOCK(id);
+}
+
+void
+c775CtxGate(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Gate: ERROR : TDC id %d not initialized \n", id, 0, 0, 0, 0,
+	     0);
+      return;
+    }
+  C775LOCK(id);
+  C775_EXEC_GATE(id);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxEnableBerr(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775EnableBerr: ERROR : QDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return;
+    }
+
+  C775LOCK(id);
+  C775_WRITE(id, control1, C775_BERR_ENABLE);	/*  | C775_BLK_END); */
+  C775UNLOCK(id);
+}
+
+void
+c775CtxDisableBerr(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775DisableBerr: ERROR : QDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return;
+    }
+
+  C775LOCK(id);
+  C775_WRITE(id, control1,
+	     ctx->shadow[id].control1 & ~(C775_BERR_ENABLE | C775_BLK_END));
+  C775UNLOCK(id);
+}
+
+void
+c775CtxIncrEventBlk(c775_ctx * ctx, int id, int count)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775IncrEventBlk: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return;
+    }
+
+  if ((count > 0) && (count <= 32))
+    ctx->state[id].evtReadCnt += count;
+}
+
+void
+c775CtxIncrEvent(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775IncrEvent: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_EXEC_INCR_EVENT(id);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxIncrWord(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775IncrWord: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_EXEC_INCR_WORD(id);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxEnable(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Enable: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_BITCLEAR2(id, C775_OFFLINE);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxDisable(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Disable: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_BITSET2(id, C775_OFFLINE);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxCommonStop(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775CommonStop: ERROR : TDC id %d not initialized \n", id, 0, 0,
+	     0, 0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_BITSET2(id, C775_COMMON_STOP);
+  C775UNLOCK(id);
+}
+
+void
+c775CtxCommonStart(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775CommonStart: ERROR : TDC id %d not initialized \n", id, 0,
+	     0, 0, 0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_BITCLEAR2(id, C775_COMMON_STOP);
+  C775UNLOCK(id);
+}
+
+
+void
+c775CtxClear(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Clear: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_EXEC_DATA_RESET(id);
+  C775UNLOCK(id);
+  ctx->state[id].evtReadCnt = -1;
+  ctx->state[id].evReady = -1;
+  ctx->state[id].eventCount = 0;
+
+}
+
+void
+c775CtxReset(c775_ctx * ctx, int id)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775Reset: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
+	     0, 0);
+      return;
+    }
+  C775LOCK(id);
+  C775_EXEC_DATA_RESET(id);
+  C775_EXEC_SOFT_RESET(id);
+  C775UNLOCK(id);
+  ctx->state[id].evtReadCnt = -1;
+  ctx->state[id].evReady = -1;
+  ctx->state[id].eventCount = 0;
+}
+
+
+/*******************************************************************************
+*
+* c775CtxSetSingleOwner - Declare that only one thread uses the specified TDC,
+*                      so its calls skip locking entirely.
+*
+*    Intended for a readout thread that owns its TDCs for the whole run.
+*    No other thread (including c775Status monitoring and crate wide calls
+*    like c775ClearAll) may touch the TDC while this is enabled.
+*
+* RETURNS: OK, or ERROR if TDC is not initialized.
+*/
+
+STATUS
+c775CtxSetSingleOwner(c775_ctx * ctx, int id, int enable)
+{
+  if ((id < 0) || (id >= ctx->maxBoards) || (ctx->p[id] == NULL))
+    {
+      logMsg("c775SetSingleOwner: ERROR : TDC id %d not initialized \n", id,
+	     0, 0, 0, 0, 0);
+      return (ERROR);
+    }
+
+  /* Wait for any thread inside a locked call to leave it */
+  if (pthread_mutex_lock(&ctx->state[id].mutex) < 0)
+    perror("pthread_mutex_lock");
+  ctx->state[id].singleOwner = (enable) ? 1 : 0;
+  if (pthread_mutex_unlock(&ctx->state[id].mutex) < 0)
+    perror("pthread_mutex_unlock");
+
+  return (OK);
+}
+
+
+/*******************************************************************************
+*
+* c775CtxMCSTInit   - Enable Multicast (MCST) writes to all TDCs
+*
+*    MCST shares its address and board order with CBLT (see c775CBLTInit),
+*    so this programs the same chain if it is not already set up.
+*
+* c775CtxClearAll   - Clear all TDCs
+* c775CtxGateAll    - Issue Software Gate to all TDCs
+* c775CtxEnableAll  - Bring all TDCs Online (Enable Gates)
+* c775CtxDisableAll - Bring all TDCs Offline (Disable Gates)
+* c775CtxResetAll   - Clear/Reset all TDCs
+*
+*    With MCST enabled each of these is one (or two) VME cycles for the
+*    whole crate.  Otherwise they loop over the TDCs.
+*
+*
+* RETURNS: c775MCSTInit: OK or ERROR, the others: None.
+*/
+
+STATUS
+c775CtxMCSTInit(c775_ctx * ctx, UINT32 addr)
+{
+  if ((ctx->cbltp != NULL) && (ctx->cbltAdr == addr))
+    return (OK);
+
+  return (c775CtxCBLTInit(ctx, addr));
+}
+
+void
+c775CtxClearAll(c775_ctx * ctx)
+{
+  int ii;
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      vmeWrite16(&ctx->cbltp->main.bitSet2, C775_DATA_RESET);
+      vmeWrite16(&ctx->cbltp->main.bitClear2, C775_DATA_RESET);
+    }
+  else
+    {
+      for (ii = 0; ii < ctx->nboards; ii++)
+	C775_EXEC_DATA_RESET(ii);
+    }
+  for (ii = 0; ii < ctx->nboards; ii++)
+    {
+      ctx->state[ii].evtReadCnt = -1;
+      ctx->state[ii].evReady = -1;
+      ctx->state[ii].eventCount = 0;
+    }
+  C775UNLOCK_ALL;
+}
+
+void
+c775CtxGateAll(c775_ctx * ctx)
+{
+  int ii;
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      vmeWrite16(&ctx->cbltp->main.swComm, 1);
+    }
+  else
+    {
+      for (ii = 0; ii < ctx->nboards; ii++)
+	C775_EXEC_GATE(ii);
+    }
+  C775UNLOCK_ALL;
+}
+
+void
+c775CtxEnableAll(c775_ctx * ctx)
+{
+  int ii;
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      vmeWrite16(&ctx->cbltp->main.bitClear2, C775_OFFLINE);
+      for (ii = 0; ii < ctx->nboards; ii++)
+	ctx->shadow[ii].bitSet2 &= ~C775_OFFLINE;
+    }
+  else
+    {
+      for (ii = 0; ii < ctx->nboards; ii++)
+	C775_BITCLEAR2(ii, C775_OFFLINE);
+    }
+  C775UNLOCK_ALL;
+}
+
+void
+c775CtxDisableAll(c775_ctx * ctx)
+{
+  int ii;
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      vmeWrite16(&ctx->cbltp->main.bitSet2, C775_OFFLINE);
+      for (ii = 0; ii < ctx->nboards; ii++)
+	ctx->shadow[ii].bitSet2 |= C775_OFFLINE;
+    }
+  else
+    {
+      for (ii = 0; ii < ctx->nboards; ii++)
+	C775_BITSET2(ii, C775_OFFLINE);
+    }
+  C775UNLOCK_ALL;
+}
+
+void
+c775CtxResetAll(c775_ctx * ctx)
+{
+  int ii;
+
+  C775LOCK_ALL;
+  if (ctx->cbltp != NULL)
+    {
+      vmeWrite16(&ctx->cbltp->main.bitSet2, C775_DATA_RESET);
+      vmeWrite16(&ctx->cbltp->main.bitClear2, C775_DATA_RESET);
+      vmeWrite16(&ctx->cbltp->main.bitSet1, C775_SOFT_RESET);
+      vmeWrite16(&ctx->cbltp->main.bitClear1, C775_SOFT_RESET);
+      /* Soft reset clears the control register, keep the chain usable */
+      vmeWrite16(&ctx->cbltp->main.control1, C775_BERR_ENABLE);
+      for (ii = 0; ii < ctx->nboards; ii++)
+	{
+	  c775ShadowReset(&ctx->shadow[ii]);
+	  ctx->shadow[ii].control1 = C775_BERR_ENABLE;
+	}
+    }
+  else
+    {
+      for (ii = 0; ii < ctx->nboards; ii++)
+	{
+	  C775_EXEC_DATA_RESET(ii);
+	  C775_EXEC_SOFT_RESET(ii);
+	}
+    }
+  for (ii = 0; ii < ctx->nboards; ii++)
+    {
+      ctx->state[ii].evtReadCnt = -1;
+      ctx->state[ii].evReady = -1;
+      ctx->state[ii].eventCount = 0;
+    }
+  C775UNLOCK_ALL;
+}
+
+
+/*******************************************************************************
+*
+* c775_data_decode - decode & print one event (header, data, trailer),
+*                    e.g. as read by c775ReadEvent
+*
+* INPUTS:    datai  - event, in CPU byte order
+*            counti - number of words in the event
+*
+* RETURNS: N/A
+*/
+
+void
+c775_data_decode(UINT32 * datai, int counti)
+{
+  unsigned char board[C775_MAX_CHANNELS], channel[C775_MAX_CHANNELS];
+  unsigned char flags[C775_MAX_CHANNELS];
+  unsigned short value[C775_MAX_CHANNELS];
+  unsigned int event[C775_MAX_CHANNELS];
+  c775_hits hits;
+  UINT32 header, trailer;
+  int ii, jj, nn, last = (counti > 1) ? (counti - 1) : 1;
+
+  if (c775DecodeHits == NULL)
+    c775SetSimd(C775_SIMD_AUTO);
+
+  hits.maxhits = C775_MAX_CHANNELS;
+  hits.board = board;
+  hits.channel = channel;
+  hits.flags = flags;
+  hits.value = value;
+  hits.event = event;
+
+  header = datai[0];
+  printf("j= %d, geo= %u, crate= %u, count= %u, top= %u, low= %u \n", 0,
+	 (header & C775_GEO_ADDR_MASK) >> 27,
+	 (header & C775_CRATE_MASK) >> 16,
+	 (header & C775_WORDCOUNT_MASK) >> 8,
+	 (header & C775_DATA_ID_MASK) >> 24, (header & 0x0000A000) >> 14);
+
+  trailer = datai[last];
+  for (jj = 1; jj < (counti - 1); jj += nn)
+    {
+      nn = counti - 1 - jj;
+      if (nn > C775_MAX_CHANNELS)
+	nn = C775_MAX_CHANNELS;
+      hits.nhits = 0;
+      (*c775DecodeHits) (&datai[jj], nn, 0, trailer & C775_EVENTCOUNT_MASK,
+			 &hits);
+      for (ii = 0; ii < nn; ii++)
+	printf("j= %d, geo= %u, data= %u, chan= %u, ov= %u, un= %u, VD= %u, \n",
+	       jj + ii, board[ii], value[ii], channel[ii],
+	       (flags[ii] & C775_HIT_OVERFLOW) ? 1 : 0,
+	       (flags[ii] & C775_HIT_UNDERFLOW) ? 1 : 0,
+	       (flags[ii] & C775_HIT_VALID) ? 1 : 0);
+    }
+
+  printf("j= %d, geo= %u, top= %u, evtcnt= %d \n", last,
+	 (trailer & C775_GEO_ADDR_MASK) >> 27,
+	 (trailer & C775_DATA_ID_MASK) >> 24, trailer & C775_EVENTCOUNT_MASK);
+}
+
+/*******************************************************************************
+*
+* Default context.  The original library calls, without a context
+* argument, work on the default context: each one calls its c775Ctx...
+* form with it.
+*
+*/
+
+/* Keep Nc775, c775MemOffset and the CBLT address up to date for code that
+   reads them */
+LOCAL void
+c775DefaultSync(void)
+{
+  Nc775 = c775DefaultCtx.nboards;
+  c775MemOffset = c775DefaultCtx.memOffset;
+  c775CBLTAdr = c775DefaultCtx.cbltAdr;
+  c775CBLTp = c775DefaultCtx.cbltp;
+}
+
+STATUS
+c775Init(UINT32 addr, UINT32 addr_inc, int ntdc, UINT16 crateID)
+{
+  STATUS rval;
+
+  rval = c775CtxInit(&c775DefaultCtx, addr, addr_inc, ntdc, crateID);
+  c775DefaultSync();
+
+  return (rval);
+}
+
+int
+c775Discover(UINT32 addr, UINT32 addr_end, UINT32 addr_inc, UINT16 crateID,
+	     UINT32 mcstAddr)
+{
+  int rval;
+
+  rval = c775CtxDiscover(&c775DefaultCtx, addr, addr_end, addr_inc, crateID,
+			 mcstAddr);
+  c775DefaultSync();
+
+  return (rval);
+}
+
+STATUS
+c775GetBoardInfo(int id, c775_boardinfo * info)
+{
+  return (c775CtxGetBoardInfo(&c775DefaultCtx, id, info));
+}
+
+STATUS
+c775GetShadow(int id, c775_shadow * regs)
+{
+  return (c775CtxGetShadow(&c775DefaultCtx, id, regs));
+}
+
+int
+c775Verify(int id, int pflag)
+{
+  return (c775CtxVerify(&c775DefaultCtx, id, pflag));
+}
+
+int
+c775ConfigApply(const c775_config * cfg)
+{
+  return (c775CtxConfigApply(&c775DefaultCtx, cfg));
+}
+
+int
+c775SetThresholds(int id, const UINT16 thr[C775_MAX_CHANNELS])
+{
+  return (c775CtxSetThresholds(&c775DefaultCtx, id, thr));
+}
+
+int
+c775SetThresholdsAll(const UINT16 thr[][C775_MAX_CHANNELS])
+{
+  return (c775CtxSetThresholdsAll(&c775DefaultCtx, thr));
+}
+
+int
+c775GetThresholds(int id, UINT16 thr[C775_MAX_CHANNELS], int verify)
+{
+  return (c775CtxGetThresholds(&c775DefaultCtx, id, thr, verify));
+}
+
+void
+c775Status(int id)
+{
+  c775CtxStatus(&c775DefaultCtx, id);
+}
+
+int
+c775PrintEvent(int id, int pflag)
+{
+  return (c775CtxPrintEvent(&c775DefaultCtx, id, pflag));
+}
+
+int
+c775ReadEvent(int id, UINT32 * data)
+{
+  return (c775CtxReadEvent(&c775DefaultCtx, id, data));
+}
+
+int
+c775FlushEvent(int id, int fflag)
+{
+  return (c775CtxFlushEvent(&c775DefaultCtx, id, fflag));
+}
+
+int
+c775ReadBlock(int id, volatile UINT32 * data, int nwrds)
+{
+  return (c775CtxReadBlock(&c775DefaultCtx, id, data, nwrds));
+}
+
+int
+c775ReadBlockStart(int id, int nwrds)
+{
+  return (c775CtxReadBlockStart(&c775DefaultCtx, id, nwrds));
+}
+
+int
+c775ReadEvents(int id, volatile UINT32 * data, int maxwords,
+	       c775_evindex * index)
+{
+  return (c775CtxReadEvents(&c775DefaultCtx, id, data, maxwords, index));
+}
+
+STATUS
+c775CBLTInit(UINT32 addr)
+{
+  STATUS rval;
+
+  rval = c775CtxCBLTInit(&c775DefaultCtx, addr);
+  c775DefaultSync();
+
+  return (rval);
+}
+
+void
+c775CBLTDisable(void)
+{
+  c775CtxCBLTDisable(&c775DefaultCtx);
+  c775DefaultSync();
+}
+
+int
+c775ReadCBLT(volatile UINT32 * data, int maxwords, c775_cbltindex * index)
+{
+  return (c775CtxReadCBLT(&c775DefaultCtx, data, maxwords, index));
+}
+
+STATUS
+c775IntRingInit(int nslots, volatile UINT32 ** bufs, int bufwords)
 {
+  return (c775CtxIntRingInit(&c775DefaultCtx, nslots, bufs, bufwords));
+}
 
-  int rfsr = 0;
-  UINT16 reg;
+int
+c775IntRingCount(void)
+{
+  return (c775CtxIntRingCount(&c775DefaultCtx));
+}
 
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775SetFSR: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return (ERROR);
-    }
+int
+c775IntRingRead(UINT32 * data, int maxwords, int *id)
+{
+  return (c775CtxIntRingRead(&c775DefaultCtx, data, maxwords, id));
+}
 
-  C775LOCK;
-  if (fsr == 0)
-    {
-      reg = vmeRead16(&c775p[id]->main.fsr) & C775_FSR_MASK;
-      rfsr = (int) (290 - reg) * 4;
-    }
-  else if ((fsr < C775_MIN_FSR) || (fsr > C775_MAX_FSR))
-    {
-      logMsg("c775SetFSR: ERROR: FSR (%d ns) out of range (140<=FSR<=1200)\n",
-	     fsr, 0, 0, 0, 0, 0);
-      C775UNLOCK;
-      return (ERROR);
-    }
-  else
-    {
-      reg = (UINT16) (290 - (fsr >> 2));
-      vmeWrite16(&c775p[id]->main.fsr, reg);
-      reg = vmeRead16(&c775p[id]->main.fsr) & C775_FSR_MASK;
-      rfsr = (int) (290 - reg) * 4;
-    }
+int
+c775IntRingWait(int msec)
+{
+  return (c775CtxIntRingWait(&c775DefaultCtx, msec));
+}
 
-  C775UNLOCK;
-  return (rfsr);
+int
+c775IntEventFd(void)
+{
+  return (c775CtxIntEventFd(&c775DefaultCtx));
+}
 
+unsigned int
+c775IntEventFdTake(void)
+{
+  return (c775CtxIntEventFdTake(&c775DefaultCtx));
 }
 
-/******************************************************************************
- *
- *
- * c775BitSet2      - Program Bit Set 2 register
- * c775BitClear2    - Program Bit clear 2 register
- *
- */
+void
+c775IntEventFdClose(void)
+{
+  c775CtxIntEventFdClose(&c775DefaultCtx);
+}
 
-INT16
-c775BitSet2(int id, UINT16 val)
+STATUS
+c775IntConnect(VOIDFUNCPTR routine, int arg, UINT16 level, UINT16 vector)
 {
-  INT16 rval;
+  return (c775CtxIntConnect(&c775DefaultCtx, routine, arg, level, vector));
+}
 
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775BitSet2: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return (ERROR);
-    }
+STATUS
+c775IntConnectBoard(int id, VOIDFUNCPTR routine, int arg, UINT16 level,
+		    UINT16 vector)
+{
+  return (c775CtxIntConnectBoard(&c775DefaultCtx, id, routine, arg, level,
+				 vector));
+}
 
-  C775LOCK;
-  if (val)
-    vmeWrite16(&c775p[id]->main.bitSet2, val);
-  rval = vmeRead16(&c775p[id]->main.bitSet2) & C775_BITSET2_MASK;
+STATUS
+c775IntEnable(int id, UINT16 evCnt)
+{
+  return (c775CtxIntEnable(&c775DefaultCtx, id, evCnt));
+}
 
-  C775UNLOCK;
-  return (rval);
+STATUS
+c775IntDisable(int iflag)
+{
+  return (c775CtxIntDisable(&c775DefaultCtx, iflag));
 }
 
-INT16
-c775BitClear2(int id, UINT16 val)
+STATUS
+c775IntEnableBoard(int id, UINT16 evCnt)
 {
-  INT16 rval;
+  return (c775CtxIntEnableBoard(&c775DefaultCtx, id, evCnt));
+}
 
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775BitClear2: ERROR : TDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return (ERROR);
-    }
+STATUS
+c775IntDisableBoard(int id)
+{
+  return (c775CtxIntDisableBoard(&c775DefaultCtx, id));
+}
 
-  C775LOCK;
-  if (val)
-    vmeWrite16(&c775p[id]->main.bitClear2, val);
-  rval = vmeRead16(&c775p[id]->main.bitSet2) & C775_BITSET2_MASK;
+STATUS
+c775IntRearm(int id)
+{
+  return (c775CtxIntRearm(&c775DefaultCtx, id));
+}
 
-  C775UNLOCK;
-  return (rval);
+STATUS
+c775IntResume(void)
+{
+  return (c775CtxIntResume(&c775DefaultCtx));
 }
 
+STATUS
+c775IntSetAdaptive(int latency)
+{
+  return (c775CtxIntSetAdaptive(&c775DefaultCtx, latency));
+}
 
-/*******************************************************************************
-*
-* c775ClearThresh  - Zero TDC thresholds for all channels
-* c775Gate         - Issue Software Gate to TDC
-* c775EnableBerr   - Enable Bus Error termination of block reads
-* c775DisableBerr  - Disable Bus Error termination of block reads
-* c775IncrEventBlk - Increment Event counter for Block reads
-* c775IncrEvent    - Increment Read pointer to next event in the Buffer
-* c775IncrWord     - Increment Read pointer to next word in the event
-* c775Enable       - Bring TDC Online (Enable Gates)
-* c775Disable      - Bring TDC Offline (Disable Gates)
-* c775CommonStop   - Program for Common Stop
-* c775CommonStart  - Program for Common Start (Default)
-* c775Clear        - Clear TDC
-* c775Reset        - Clear/Reset TDC
-*
-*
-* RETURNS: None.
-*/
+int
+c775IntAdaptCheck(void)
+{
+  return (c775CtxIntAdaptCheck(&c775DefaultCtx));
+}
 
-void
-c775ClearThresh(int id)
+STATUS
+c775IntGetStats(int id, c775_intstats * stats)
 {
-  int ii;
+  return (c775CtxIntGetStats(&c775DefaultCtx, id, stats));
+}
 
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775ClearThresh: ERROR : TDC id %d not initialized \n", id, 0,
-	     0, 0, 0, 0);
-      return;
-    }
+UINT16
+c775Sparse(int id, int over, int under)
+{
+  return (c775CtxSparse(&c775DefaultCtx, id, over, under));
+}
 
-  C775LOCK;
-  for (ii = 0; ii < C775_MAX_CHANNELS; ii++)
-    {
-      vmeWrite16(&c775p[id]->main.threshold[ii], 0);
-    }
-  C775UNLOCK;
+int
+c775Dready(int id)
+{
+  return (c775CtxDready(&c775DefaultCtx, id));
+}
+
+int
+c775DreadyFast(int id)
+{
+  return (c775CtxDreadyFast(&c775DefaultCtx, id));
+}
+
+int
+c775DreadyMin(int id, int nmin)
+{
+  return (c775CtxDreadyMin(&c775DefaultCtx, id, nmin));
+}
+
+int
+c775SetFSR(int id, UINT16 fsr)
+{
+  return (c775CtxSetFSR(&c775DefaultCtx, id, fsr));
+}
+
+INT16
+c775BitSet2(int id, UINT16 val)
+{
+  return (c775CtxBitSet2(&c775DefaultCtx, id, val));
+}
+
+INT16
+c775BitClear2(int id, UINT16 val)
+{
+  return (c775CtxBitClear2(&c775DefaultCtx, id, val));
+}
+
+void
+c775ClearThresh(int id)
+{
+  c775CtxClearThresh(&c775DefaultCtx, id);
 }
 
 void
 c775Gate(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775Gate: ERROR : TDC id %d not initialized \n", id, 0, 0, 0, 0,
-	     0);
-      return;
-    }
-  C775LOCK;
-  C775_EXEC_GATE(id);
-  C775UNLOCK;
+  c775CtxGate(&c775DefaultCtx, id);
 }
 
 void
 c775EnableBerr(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775EnableBerr: ERROR : QDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return;
-    }
-
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.control1, C775_BERR_ENABLE);	/*  | C775_BLK_END); */
-  C775UNLOCK;
+  c775CtxEnableBerr(&c775DefaultCtx, id);
 }
 
 void
 c775DisableBerr(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775DisableBerr: ERROR : QDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return;
-    }
-
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.control1,
-	    vmeRead16(&c775p[id]->main.control1)
-	     & ~(C775_BERR_ENABLE | C775_BLK_END));
-  C775UNLOCK;
+  c775CtxDisableBerr(&c775DefaultCtx, id);
 }
 
 void
 c775IncrEventBlk(int id, int count)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775IncrEventBlk: ERROR : TDC id %d not initialized \n", id, 0,
-	     0, 0, 0, 0);
-      return;
-    }
-
-  if ((count > 0) && (count <= 32))
-    c775EvtReadCnt[id] += count;
+  c775CtxIncrEventBlk(&c775DefaultCtx, id, count);
 }
 
 void
 c775IncrEvent(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775IncrEvent: ERROR : TDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return;
-    }
-  C775LOCK;
-  C775_EXEC_INCR_EVENT(id);
-  C775UNLOCK;
+  c775CtxIncrEvent(&c775DefaultCtx, id);
 }
 
 void
 c775IncrWord(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775IncrWord: ERROR : TDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return;
-    }
-  C775LOCK;
-  C775_EXEC_INCR_WORD(id);
-  C775UNLOCK;
+  c775CtxIncrWord(&c775DefaultCtx, id);
 }
 
 void
 c775Enable(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775Enable: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return;
-    }
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.bitClear2, C775_OFFLINE);
-  C775UNLOCK;
+  c775CtxEnable(&c775DefaultCtx, id);
 }
 
 void
 c775Disable(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775Disable: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return;
-    }
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.bitSet2, C775_OFFLINE);
-  C775UNLOCK;
+  c775CtxDisable(&c775DefaultCtx, id);
 }
 
 void
 c775CommonStop(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775CommonStop: ERROR : TDC id %d not initialized \n", id, 0, 0,
-	     0, 0, 0);
-      return;
-    }
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.bitSet2, C775_COMMON_STOP);
-  C775UNLOCK;
+  c775CtxCommonStop(&c775DefaultCtx, id);
 }
 
 void
 c775CommonStart(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775CommonStart: ERROR : TDC id %d not initialized \n", id, 0,
-	     0, 0, 0, 0);
-      return;
-    }
-  C775LOCK;
-  vmeWrite16(&c775p[id]->main.bitClear2, C775_COMMON_STOP);
-  C775UNLOCK;
+  c775CtxCommonStart(&c775DefaultCtx, id);
 }
 
-
 void
 c775Clear(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775Clear: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return;
-    }
-  C775LOCK;
-  C775_EXEC_DATA_RESET(id);
-  C775UNLOCK;
-  c775EvtReadCnt[id] = -1;
-  c775EventCount[id] = 0;
-
+  c775CtxClear(&c775DefaultCtx, id);
 }
 
 void
 c775Reset(int id)
 {
-  if ((id < 0) || (c775p[id] == NULL))
-    {
-      logMsg("c775Reset: ERROR : TDC id %d not initialized \n", id, 0, 0, 0,
-	     0, 0);
-      return;
-    }
-  C775LOCK;
-  C775_EXEC_DATA_RESET(id);
-  C775_EXEC_SOFT_RESET(id);
-  C775UNLOCK;
-  c775EvtReadCnt[id] = -1;
-  c775EventCount[id] = 0;
+  c775CtxReset(&c775DefaultCtx, id);
 }
 
+STATUS
+c775SetSingleOwner(int id, int enable)
+{
+  return (c775CtxSetSingleOwner(&c775DefaultCtx, id, enable));
+}
 
-/*******************************************************************************
-*
-* c792_data_decode- decode & print MEB buffer
-*
-*
-*  NO RETURN
-void   (MEB buffer, no words in buffer);
- 
-*/
-void   c775_data_decode(UINT32 *datai, int counti){
-
-UINT32 geo_mask=0xf8000000,     geo_shift=27,   geo_val; 
-UINT32 Hcrate_mask=0x00ff0000,  Hcrate_shift=16, Hcrate_val; 
-UINT32 Hcount_mask=0x00003f00,  Hcount_shift=8,  Hcount_val; 
-UINT32 Htop_mask=0x07000000,    Htop_shift=24,    Htop_val ; 
-UINT32 Hlow_mask=0x0000A000,    Hlow_shift=14,    Hlow_val;
-
-
-UINT32 Ddata_mask=0X00000fff,   Ddata_shift=0,   Ddata_val;
-UINT32 Dchan_mask=0x001E0000,   Dchan_shift=17,  Dchan_val;
-UINT32 Dovfl_mask=0x00001000,   Dovfl_shift=12,  Dovfl_val;
-UINT32 Dunfl_mask=0x00002000,   Dunfl_shift=13,  Dunfl_val;
-UINT32 D__VD_mask=0x00004000,   D__VD_shift=14,  D__VD_val;
-
-
-UINT32 Ttop_mask=0x07000000, Ttop_shift=24, Ttop_val;
-UINT32 Tevtcnt_mask=0x00ffffff, Tevtcnt_shift=0, Tevtcnt_val;
-
+STATUS
+c775MCSTInit(UINT32 addr)
+{
+  STATUS rval;
 
+  rval = c775CtxMCSTInit(&c775DefaultCtx, addr);
+  c775DefaultSync();
 
-int jj;
+  return (rval);
+}
 
-jj=0;
-geo_val=(datai[jj]&geo_mask)>>geo_shift;
-Hcrate_val=(datai[jj]&Hcrate_mask)>>Hcrate_shift;
-Hcount_val=(datai[jj]&Hcount_mask)>>Hcount_shift;
-Htop_val=(datai[jj]&Htop_mask)>>Htop_shift;
-Hlow_val=(datai[jj]&Hlow_mask)>>Hlow_shift;
+void
+c775ClearAll(void)
+{
+  c775CtxClearAll(&c775DefaultCtx);
+}
 
-printf("j= %d, geo= %u, crate= %u, count= %u, top= %u, low= %u \n",jj,geo_val,Hcrate_val,Hcount_val,Htop_val,Hlow_val);
+void
+c775GateAll(void)
+{
+  c775CtxGateAll(&c775DefaultCtx);
+}
 
-for(jj=1;jj<(counti-1);jj++) {
- 	 geo_val=(datai[jj]&geo_mask)>>geo_shift;
-	 Ddata_val=(datai[jj]&Ddata_mask)>>Ddata_shift;
-	 Dchan_val=(datai[jj]&Dchan_mask)>>Dchan_shift;
-	 Dovfl_val=(datai[jj]&Dovfl_mask)>>Dovfl_shift;
-	 Dunfl_val=(datai[jj]&Dunfl_mask)>>Dunfl_shift;
-	 D__VD_val=(datai[jj]&D__VD_mask)>>D__VD_shift;
-	 printf("j= %d, geo= %u, data= %u, chan= %u, ov= %u, un= %u, VD= %u, \n", jj, geo_val,Ddata_val,Dchan_val, Dovfl_val, Dunfl_val, D__VD_val);
-    }
-    
- geo_val=(datai[jj]&geo_mask)>>geo_shift;
- Ttop_val=(datai[jj]&Ttop_mask)>>Ttop_shift;
- Tevtcnt_val=(datai[jj]&Tevtcnt_mask)>>Tevtcnt_shift;
- printf("j= %d, geo= %u, top= %u, evtcnt= %d \n", jj, geo_val,Ttop_val, Tevtcnt_val);
-   
+void
+c775EnableAll(void)
+{
+  c775CtxEnableAll(&c775DefaultCtx);
 }
 
+void
+c775DisableAll(void)
+{
+  c775CtxDisableAll(&c775DefaultCtx);
+}
 
+void
+c775ResetAll(void)
+{
+  c775CtxResetAll(&c775DefaultCtx);
+}
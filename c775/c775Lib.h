@@ -12,8 +12,18 @@
 #ifndef __C775LIB__
 #define __C775LIB__
 
+#define C775_MAX_BOARDS     20
 #define C775_MAX_CHANNELS   32
 #define C775_MAX_WORDS_PER_EVENT  34
+#define C775_MAX_EVENTS     32	/* Depth of the output buffer in events */
+#define C775_MAX_BLOCK_WORDS  (C775_MAX_EVENTS * C775_MAX_WORDS_PER_EVENT)
+#define C775_MAX_DMA_BUFS   4	/* Rotating buffers for asynchronous reads */
+#define C775_MAX_RING_SLOTS 32	/* Buffers of the interrupt readout ring */
+#define C775_MAX_CTX        16	/* Library contexts, default one included */
+#define C775_CTX_MAX_BOARDS 32	/* TDCs in one context (c775CtxCreate) */
+
+/* Library context: a crate of TDCs and its readout state (c775CtxCreate) */
+typedef struct c775_ctx_struct c775_ctx;
 
 /* Define a Structure for access to TDC*/
 typedef struct  c775_struct
@@ -102,6 +112,142 @@ typedef struct
   /* 0x8000          */ c775_ROM  rom;
 }  c775_regs;
 
+/* Address and ROM data of a TDC (c775GetBoardInfo) */
+typedef struct c775_boardinfo_struct
+{
+  UINT32 vmeAddr;		/* VME base address */
+  UINT32 serial;		/* Serial number */
+  UINT16 revision;		/* Board revision */
+  UINT16 firmware;		/* Firmware revision */
+} c775_boardinfo;
+
+/* Configuration registers of a TDC as last written by the library
+   (c775GetShadow, c775Verify).  Bit Set 2 holds the bits set through
+   Bit Set 2 / Bit Clear 2. */
+typedef struct c775_shadow_struct
+{
+  UINT16 cbltAddr;
+  UINT16 intLevel;
+  UINT16 intVector;
+  UINT16 control1;
+  UINT16 cbltControl;
+  UINT16 evTrigger;
+  UINT16 fclrWindow;
+  UINT16 bitSet2;
+  UINT16 crateSelect;
+  UINT16 fsr;
+  UINT16 slideConst;
+  UINT16 threshold[C775_MAX_CHANNELS];
+} c775_shadow;
+
+/* Configuration of the TDCs (c775ConfigLoad, c775ConfigApply) */
+typedef struct c775_boardcfg_struct
+{
+  UINT16 fsr;			/* Full Scale Range (ns) */
+  UINT16 threshold[C775_MAX_CHANNELS];	/* Threshold register values */
+  UINT16 suppressOver;		/* Suppress Overflow hits */
+  UINT16 suppressUnder;		/* Suppress hits under threshold */
+  UINT16 commonStop;		/* 1: Common Stop, 0: Common Start */
+} c775_boardcfg;
+
+typedef struct c775_config_struct
+{
+  UINT16 crateID;
+  UINT16 intLevel;		/* VME interrupt level, 0: default */
+  UINT16 intVector;		/* Interrupt vector, 0: default */
+  UINT16 intEvents;		/* Events per interrupt */
+  c775_boardcfg board[C775_CTX_MAX_BOARDS];	/* By TDC id */
+} c775_config;
+
+/* Interrupt statistics (c775IntGetStats) */
+typedef struct c775_intstats_struct
+{
+  unsigned int count;		/* Interrupts since enabled */
+  unsigned int irqRate;		/* Interrupts per second */
+  unsigned int evRate;		/* Trigger rate estimate (events/s) */
+  int evTrigger;		/* Event threshold in use */
+  int latency;			/* Latency ceiling (us), 0: fixed threshold */
+  unsigned int flushes;		/* Thresholds dropped by the ceiling */
+} c775_intstats;
+
+/* Event boundaries of a multi-event block read (c775ReadEvents) */
+typedef struct c775_evindex_struct
+{
+  int nevents;			/* Complete events found in the block */
+  int nwords;			/* Longwords moved by the DMA */
+  int readCount;		/* Event Read Count after the block */
+  int offset[C775_MAX_BLOCK_WORDS / 2 + 1];	/* Header position of each event,
+						   offset[nevents] = end of last */
+} c775_evindex;
+
+/* Per board split of a chained block transfer (c775ReadCBLT) */
+typedef struct c775_cbltindex_struct
+{
+  int nwords;			/* Longwords moved by the DMA */
+  int offset[C775_MAX_BOARDS];	/* First word of each TDC's data */
+  int nwrds[C775_MAX_BOARDS];	/* Longwords from each TDC */
+  int nevents[C775_MAX_BOARDS];	/* Events from each TDC */
+} c775_cbltindex;
+
+/* Validated event boundaries of a block of data (c775ScanBlock) */
+#define C775_MAX_SCAN_WORDS   (C775_MAX_BOARDS * C775_MAX_BLOCK_WORDS)
+#define C775_MAX_SCAN_EVENTS  (C775_MAX_BOARDS * C775_MAX_EVENTS)
+#define C775_SCAN_MASKS       ((C775_MAX_SCAN_WORDS + 63) / 64)
+
+/* Word classes of a block, one bit per word (work space of c775ScanBlock) */
+typedef struct c775_scanmask_struct
+{
+  unsigned long long hdr[C775_SCAN_MASKS];	/* Header */
+  unsigned long long trl[C775_SCAN_MASKS];	/* Trailer (End of Block) */
+  unsigned long long fill[C775_SCAN_MASKS];	/* Not valid datum */
+  unsigned long long nond[C775_SCAN_MASKS];	/* Anything but a valid datum */
+  unsigned long long geoc[C775_SCAN_MASKS];	/* GEO differs from the word before */
+} c775_scanmask;
+
+typedef struct c775_scan_struct
+{
+  int nevents;			/* Complete, valid events found */
+  int nwords;			/* Longwords scanned */
+  int error;			/* C775_SCAN_OK, or why the scan stopped */
+  int errOffset;		/* Word at which the scan stopped */
+  int offset[C775_MAX_SCAN_EVENTS + 1];	/* Header position of each event,
+					   offset[nevents] = end of last */
+  unsigned char geo[C775_MAX_SCAN_EVENTS];	/* GEO address of each event */
+  c775_scanmask mask;		/* Work space, kept off the stack */
+} c775_scan;
+
+#define C775_SCAN_OK         0
+#define C775_SCAN_TRUNCATED  1	/* Block ends inside an event */
+#define C775_SCAN_BAD_COUNT  2	/* Header word count does not match the data */
+#define C775_SCAN_BAD_GEO    3	/* GEO address changes inside an event */
+#define C775_SCAN_ORPHAN     4	/* Data or trailer outside of an event */
+#define C775_SCAN_OVERFLOW   5	/* More than C775_MAX_SCAN_EVENTS events */
+
+/* Decoded hits, as a structure of arrays in caller memory
+   (c775DecodeBlock) */
+typedef struct c775_hits_struct
+{
+  int maxhits;			/* Size of each array, set by the caller */
+  int nhits;			/* Hits decoded */
+  int nevents;			/* Events decoded */
+  int nwords;			/* Longwords decoded */
+  unsigned char *board;		/* GEO address */
+  unsigned char *channel;	/* 0 - 31 */
+  unsigned char *flags;		/* C775_HIT_OVERFLOW | _UNDERFLOW | _VALID */
+  unsigned short *value;	/* 12 bit TDC value */
+  unsigned int *event;		/* Event number, from the trailer */
+} c775_hits;
+
+#define C775_HIT_OVERFLOW    0x1
+#define C775_HIT_UNDERFLOW   0x2
+#define C775_HIT_VALID       0x4
+
+/* Vector instruction sets for the block scan/decode kernels (c775SetSimd) */
+#define C775_SIMD_AUTO     -1	/* Best supported by the CPU */
+#define C775_SIMD_SCALAR    0
+#define C775_SIMD_SSE4      1
+#define C775_SIMD_AVX2      2
+
 
 #define C775_BOARD_ID   0x00000307
 
@@ -131,6 +277,11 @@ typedef struct
 #define C775_BUSY          0x4
 #define C775_EVRDY         0x100
 
+/* cbltControl */
+#define C775_CBLT_LAST     0x1
+#define C775_CBLT_FIRST    0x2
+#define C775_CBLT_MIDDLE   0x3
+
 /* control */
 #define C775_BLK_END       0x04
 #define C775_BERR_ENABLE   0x20
@@ -175,26 +326,76 @@ typedef struct
 #define C775_EVENTCOUNT_MASK 0x00ffffff
 #define C775_GEO_ADDR_MASK   0xf8000000
 #define C775_TDC_DATA_MASK   0x00000fff
+#define C775_TDC_CHANNEL_MASK 0x001f0000	/* Channel 0-31 of a datum */
+#define C775_TDC_FLAGS_MASK  0x00007000	/* Overflow, Underflow, Valid */
 
 /* Function Prototypes */
 STATUS c775Init(UINT32 addr, UINT32 addr_inc, int nadc, UINT16 crateID);
+int c775Discover(UINT32 addr, UINT32 addr_end, UINT32 addr_inc,
+		 UINT16 crateID, UINT32 mcstAddr);
+STATUS c775GetBoardInfo(int id, c775_boardinfo * info);
+STATUS c775GetShadow(int id, c775_shadow * regs);
+int c775Verify(int id, int pflag);
+void c775ConfigDefault(c775_config * cfg);
+STATUS c775ConfigLoad(const char *filename, c775_config * cfg);
+int c775ConfigApply(const c775_config * cfg);
+int c775SetThresholds(int id, const UINT16 thr[C775_MAX_CHANNELS]);
+int c775SetThresholdsAll(const UINT16 thr[][C775_MAX_CHANNELS]);
+int c775GetThresholds(int id, UINT16 thr[C775_MAX_CHANNELS], int verify);
 void c775Status(int id);
 int c775PrintEvent(int id, int pflag);
 int c775ReadEvent(int id, UINT32 * data);
 int c775FlushEvent(int id, int fflag);
 int c775ReadBlock(int id, volatile UINT32 * data, int nwrds);
+STATUS c775ReadBlockBufInit(int nbufs, volatile UINT32 ** bufs, int bufwords);
+int c775ReadBlockStart(int id, int nwrds);
+int c775ReadBlockPoll(void);
+int c775ReadBlockWait(volatile UINT32 ** data);
+STATUS c775ReadBlockRelease(volatile UINT32 * data);
+int c775ReadEvents(int id, volatile UINT32 * data, int maxwords,
+		   c775_evindex * index);
+STATUS c775CBLTInit(UINT32 addr);
+void c775CBLTDisable(void);
+int c775ReadCBLT(volatile UINT32 * data, int maxwords, c775_cbltindex * index);
+int c775SetSimd(int level);
+void c775SwapBlock(volatile UINT32 * data, int nwrds);
+int c775SetBlockSwap(int enable);
+int c775ScanBlock(volatile UINT32 * data, int nwrds, int swap,
+		  c775_scan * scan);
+int c775DecodeBlock(volatile UINT32 * data, int nwrds, int swap,
+		    c775_hits * hits);
 STATUS c775IntConnect(VOIDFUNCPTR routine, int arg, UINT16 level,
 		      UINT16 vector);
 STATUS c775IntEnable(int id, UINT16 evCnt);
 STATUS c775IntDisable(int iflag);
 STATUS c775IntResume(void);
+STATUS c775IntConnectBoard(int id, VOIDFUNCPTR routine, int arg, UINT16 level,
+			   UINT16 vector);
+STATUS c775IntEnableBoard(int id, UINT16 evCnt);
+STATUS c775IntDisableBoard(int id);
+STATUS c775IntRearm(int id);
+STATUS c775IntRingInit(int nslots, volatile UINT32 ** bufs, int bufwords);
+int c775IntRingCount(void);
+int c775IntRingRead(UINT32 * data, int maxwords, int *id);
+int c775IntRingWait(int msec);
+int c775IntEventFd(void);
+unsigned int c775IntEventFdTake(void);
+void c775IntEventFdClose(void);
+STATUS c775IntSetAdaptive(int latency);
+int c775IntAdaptCheck(void);
+STATUS c775IntGetStats(int id, c775_intstats * stats);
 UINT16 c775Sparse(int id, int over, int under);
 int c775Dready(int id);
+int c775DreadyFast(int id);
+int c775DreadyMin(int id, int nmin);
+unsigned int c775GetBusCycles(void);
 int c775SetFSR(int id, UINT16 fsr);
 INT16 c775BitSet2(int id, UINT16 val);
 INT16 c775BitClear2(int id, UINT16 val);
 void c775ClearThresh(int id);
 void c775Gate(int id);
+void c775EnableBerr(int id);
+void c775DisableBerr(int id);
 void c775IncrEventBlk(int id, int count);
 void c775IncrEvent(int id);
 void c775IncrWord(int id);
@@ -204,6 +405,95 @@ void c775CommonStop(int id);
 void c775CommonStart(int id);
 void c775Clear(int id);
 void c775Reset(int id);
+STATUS c775SetSingleOwner(int id, int enable);
+STATUS c775MCSTInit(UINT32 addr);
+void c775ClearAll(void);
+void c775GateAll(void);
+void c775EnableAll(void);
+void c775DisableAll(void);
+void c775ResetAll(void);
 void c775_data_decode(UINT32 *datai, int counti);
 
+/* Contexts (c775CtxCreate): the calls above work on the default context,
+   these on the one given */
+c775_ctx *c775CtxCreate(int maxBoards);
+STATUS c775CtxDestroy(c775_ctx * ctx);
+c775_ctx *c775CtxDefault(void);
+int c775CtxNBoards(c775_ctx * ctx);
+STATUS c775CtxInit(c775_ctx * ctx, UINT32 addr, UINT32 addr_inc, int nadc,
+		   UINT16 crateID);
+int c775CtxDiscover(c775_ctx * ctx, UINT32 addr, UINT32 addr_end,
+		    UINT32 addr_inc, UINT16 crateID, UINT32 mcstAddr);
+STATUS c775CtxGetBoardInfo(c775_ctx * ctx, int id, c775_boardinfo * info);
+STATUS c775CtxGetShadow(c775_ctx * ctx, int id, c775_shadow * regs);
+int c775CtxVerify(c775_ctx * ctx, int id, int pflag);
+int c775CtxConfigApply(c775_ctx * ctx, const c775_config * cfg);
+int c775CtxSetThresholds(c775_ctx * ctx, int id,
+			 const UINT16 thr[C775_MAX_CHANNELS]);
+int c775CtxSetThresholdsAll(c775_ctx * ctx,
+			    const UINT16 thr[][C775_MAX_CHANNELS]);
+int c775CtxGetThresholds(c775_ctx * ctx, int id,
+			 UINT16 thr[C775_MAX_CHANNELS], int verify);
+void c775CtxStatus(c775_ctx * ctx, int id);
+int c775CtxPrintEvent(c775_ctx * ctx, int id, int pflag);
+int c775CtxReadEvent(c775_ctx * ctx, int id, UINT32 * data);
+int c775CtxFlushEvent(c775_ctx * ctx, int id, int fflag);
+int c775CtxReadBlock(c775_ctx * ctx, int id, volatile UINT32 * data,
+		     int nwrds);
+int c775CtxReadBlockStart(c775_ctx * ctx, int id, int nwrds);
+int c775CtxReadEvents(c775_ctx * ctx, int id, volatile UINT32 * data,
+		      int maxwords, c775_evindex * index);
+STATUS c775CtxCBLTInit(c775_ctx * ctx, UINT32 addr);
+void c775CtxCBLTDisable(c775_ctx * ctx);
+int c775CtxReadCBLT(c775_ctx * ctx, volatile UINT32 * data, int maxwords,
+		    c775_cbltindex * index);
+STATUS c775CtxIntConnect(c775_ctx * ctx, VOIDFUNCPTR routine, int arg,
+			 UINT16 level, UINT16 vector);
+STATUS c775CtxIntEnable(c775_ctx * ctx, int id, UINT16 evCnt);
+STATUS c775CtxIntDisable(c775_ctx * ctx, int iflag);
+STATUS c775CtxIntResume(c775_ctx * ctx);
+STATUS c775CtxIntConnectBoard(c775_ctx * ctx, int id, VOIDFUNCPTR routine,
+			      int arg, UINT16 level, UINT16 vector);
+STATUS c775CtxIntEnableBoard(c775_ctx * ctx, int id, UINT16 evCnt);
+STATUS c775CtxIntDisableBoard(c775_ctx * ctx, int id);
+STATUS c775CtxIntRearm(c775_ctx * ctx, int id);
+STATUS c775CtxIntRingInit(c775_ctx * ctx, int nslots, volatile UINT32 ** bufs,
+			  int bufwords);
+int c775CtxIntRingCount(c775_ctx * ctx);
+int c775CtxIntRingRead(c775_ctx * ctx, UINT32 * data, int maxwords, int *id);
+int c775CtxIntRingWait(c775_ctx * ctx, int msec);
+int c775CtxIntEventFd(c775_ctx * ctx);
+unsigned int c775CtxIntEventFdTake(c775_ctx * ctx);
+void c775CtxIntEventFdClose(c775_ctx * ctx);
+STATUS c775CtxIntSetAdaptive(c775_ctx * ctx, int latency);
+int c775CtxIntAdaptCheck(c775_ctx * ctx);
+STATUS c775CtxIntGetStats(c775_ctx * ctx, int id, c775_intstats * stats);
+UINT16 c775CtxSparse(c775_ctx * ctx, int id, int over, int under);
+int c775CtxDready(c775_ctx * ctx, int id);
+int c775CtxDreadyFast(c775_ctx * ctx, int id);
+int c775CtxDreadyMin(c775_ctx * ctx, int id, int nmin);
+int c775CtxSetFSR(c775_ctx * ctx, int id, UINT16 fsr);
+INT16 c775CtxBitSet2(c775_ctx * ctx, int id, UINT16 val);
+INT16 c775CtxBitClear2(c775_ctx * ctx, int id, UINT16 val);
+void c775CtxClearThresh(c775_ctx * ctx, int id);
+void c775CtxGate(c775_ctx * ctx, int id);
+void c775CtxEnableBerr(c775_ctx * ctx, int id);
+void c775CtxDisableBerr(c775_ctx * ctx, int id);
+void c775CtxIncrEventBlk(c775_ctx * ctx, int id, int count);
+void c775CtxIncrEvent(c775_ctx * ctx, int id);
+void c775CtxIncrWord(c775_ctx * ctx, int id);
+void c775CtxEnable(c775_ctx * ctx, int id);
+void c775CtxDisable(c775_ctx * ctx, int id);
+void c775CtxCommonStop(c775_ctx * ctx, int id);
+void c775CtxCommonStart(c775_ctx * ctx, int id);
+void c775CtxClear(c775_ctx * ctx, int id);
+void c775CtxReset(c775_ctx * ctx, int id);
+STATUS c775CtxSetSingleOwner(c775_ctx * ctx, int id, int enable);
+STATUS c775CtxMCSTInit(c775_ctx * ctx, UINT32 addr);
+void c775CtxClearAll(c775_ctx * ctx);
+void c775CtxGateAll(c775_ctx * ctx);
+void c775CtxEnableAll(c775_ctx * ctx);
+void c775CtxDisableAll(c775_ctx * ctx);
+void c775CtxResetAll(c775_ctx * ctx);
+
 #endif /* __C775LIB__ */
@@ -0,0 +1,1318 @@
+/******************************************************************************
+*
+*  c775Emu.c  -  In-process software emulator of C.A.E.N. Model 775 TDCs and
+*                the subset of the jvme VME library used by libc775.
+*
+*                VME windows are reserved (PROT_NONE) below 4GB so that the
+*                library's 32 bit address arithmetic holds; all register and
+*                FIFO traffic must go through vmeRead/vmeWrite/vmeDmaSend,
+*                exactly as on real hardware.
+*
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "jvme.h"
+#include "c775Lib.h"
+#include "c775Emu.h"
+
+#define EMU_FIFO_EVENTS   32
+#define EMU_FIFO_WORDS    (EMU_FIFO_EVENTS * C775_MAX_WORDS_PER_EVENT)
+#define EMU_BOARD_SIZE    0x10000
+#define EMU_WIN_SIZE      0x01000000
+#define EMU_MAX_WINDOWS   16
+#define EMU_MAX_VECTORS   256
+#define EMU_MAX_PARTS     16
+
+#define REG(x)  offsetof(c775_regs, x)
+
+/* VME windows mapped into the local address space */
+typedef struct
+{
+  int a32;
+  UINT32 vmeBase;
+  char *local;
+} emuWindow;
+
+/* One emulated TDC */
+typedef struct
+{
+  pthread_mutex_t lock;
+  UINT32 base;
+  int slot;
+  /* registers */
+  UINT16 bitSet1, bitSet2, control1;
+  UINT16 intLevel, intVector, evTrigger;
+  UINT16 crateSelect, fsr, cbltAddr, cbltControl;
+  UINT16 fclrWindow, slideConst, aderHigh, aderLow;
+  UINT16 threshold[C775_MAX_CHANNELS];
+  UINT32 evCount;
+  /* output buffer */
+  UINT32 fifo[EMU_FIFO_WORDS];
+  int head, nwords, nevents;
+  int blkDone;			/* BLK_END: trailer already sent this DMA */
+  unsigned long long delivered;	/* self-timed triggers seen */
+} emuBoard;
+
+typedef struct
+{
+  VOIDFUNCPTR routine;
+  UINT32 arg;
+  UINT32 level;
+} emuIsr;
+
+LOCAL pthread_mutex_t emuMutex = PTHREAD_MUTEX_INITIALIZER;
+LOCAL pthread_mutex_t emuBusMutex = PTHREAD_MUTEX_INITIALIZER;
+LOCAL pthread_mutex_t emuUserBusMutex = PTHREAD_MUTEX_INITIALIZER;
+LOCAL emuWindow emuWin[EMU_MAX_WINDOWS];
+LOCAL int emuNWin = 0;
+LOCAL emuBoard *emuBd[C775EMU_MAX_BOARDS];
+LOCAL int emuNBd = 0;
+
+LOCAL int emuCycleNs = 0, emuDmaSetupNs = 0, emuDmaWordNs = 0;
+LOCAL double emuRate = 0.0;
+LOCAL int emuD32Regs = 1;	/* D32 cycles on registers split in two */
+LOCAL struct timespec emuRateStart;
+LOCAL int emuHits = 8, emuPoisson = 0;
+LOCAL double emuHist[C775_MAX_CHANNELS + 1];
+LOCAL int emuHistN = 0;
+LOCAL unsigned int emuSeed = 0x775;
+
+LOCAL c775EmuStats emuStats;
+
+/* DMA engine: one transfer in flight, like the bridge */
+LOCAL int emuDmaResult = 0;
+LOCAL struct timespec emuDmaEnd;
+
+/* DMA memory partitions: the only memory the DMA engine can reach */
+LOCAL DMA_MEM_ID emuPart[EMU_MAX_PARTS];
+
+/* Interrupts */
+LOCAL emuIsr emuIsrTable[EMU_MAX_VECTORS];
+LOCAL pthread_t emuIrqThread;
+LOCAL int emuIrqRunning = 0;
+
+#define STAT_ADD(f, n) __sync_fetch_and_add(&emuStats.f, (n))
+
+/*----------------------------------------------------------------------------
+ * Time helpers
+ */
+
+LOCAL inline long long
+emuNs(const struct timespec *t)
+{
+  return (long long) t->tv_sec * 1000000000LL + t->tv_nsec;
+}
+
+LOCAL inline long long
+emuNow(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return emuNs(&t);
+}
+
+LOCAL void
+emuSpin(long long ns)
+{
+  long long end;
+
+  if (ns <= 0)
+    return;
+  end = emuNow() + ns;
+  while (emuNow() < end)
+    ;
+}
+
+/* Single bus cycle: the bus is shared, so cycles are serialized */
+LOCAL inline void
+emuCycle(void)
+{
+  if (emuCycleNs > 0)
+    {
+      pthread_mutex_lock(&emuBusMutex);
+      emuSpin(emuCycleNs);
+      pthread_mutex_unlock(&emuBusMutex);
+    }
+}
+
+LOCAL unsigned int
+emuRand(void)
+{
+  unsigned int x = __sync_add_and_fetch(&emuSeed, 0x9e3779b9);
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+LOCAL double
+emuUniform(void)
+{
+  return (emuRand() >> 8) / 16777216.0;
+}
+
+/*----------------------------------------------------------------------------
+ * Address decoding
+ */
+
+LOCAL emuWindow *
+emuWindowGet(int a32, UINT32 vmeAddr, int create)
+{
+  int ii;
+  UINT32 wbase = a32 ? (vmeAddr & ~(EMU_WIN_SIZE - 1)) : 0;
+  void *map;
+
+  for (ii = 0; ii < emuNWin; ii++)
+    if ((emuWin[ii].a32 == a32) && (emuWin[ii].vmeBase == wbase))
+      return &emuWin[ii];
+
+  if (!create || (emuNWin == EMU_MAX_WINDOWS))
+    return NULL;
+
+  map = mmap(NULL, EMU_WIN_SIZE, PROT_NONE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_32BIT, -1, 0);
+  if (map == MAP_FAILED)
+    {
+      perror("c775Emu: mmap");
+      return NULL;
+    }
+
+  emuWin[emuNWin].a32 = a32;
+  emuWin[emuNWin].vmeBase = wbase;
+  emuWin[emuNWin].local = (char *) map;
+  return &emuWin[emuNWin++];
+}
+
+/* Local address -> VME address.  Returns -1 if not inside a window */
+LOCAL int
+emuLocalToVme(volatile void *addr, UINT32 * vmeAddr)
+{
+  int ii;
+  char *p = (char *) addr;
+
+  for (ii = 0; ii < emuNWin; ii++)
+    {
+      if ((p >= emuWin[ii].local) && (p < emuWin[ii].local + EMU_WIN_SIZE))
+	{
+	  *vmeAddr = emuWin[ii].vmeBase + (UINT32) (p - emuWin[ii].local);
+	  return 0;
+	}
+    }
+  return -1;
+}
+
+LOCAL emuBoard *
+emuBoardAt(UINT32 vmeAddr, UINT32 * offset)
+{
+  int ii;
+
+  for (ii = 0; ii < emuNBd; ii++)
+    {
+      if ((vmeAddr >= emuBd[ii]->base)
+	  && (vmeAddr < emuBd[ii]->base + EMU_BOARD_SIZE))
+	{
+	  *offset = vmeAddr - emuBd[ii]->base;
+	  return emuBd[ii];
+	}
+    }
+  return NULL;
+}
+
+/* True when vmeAddr falls in the MCST/CBLT space of any board */
+LOCAL int
+emuIsMcst(UINT32 vmeAddr)
+{
+  int ii;
+
+  for (ii = 0; ii < emuNBd; ii++)
+    if (emuBd[ii]->cbltControl & 0x3)
+      if ((emuBd[ii]->cbltAddr & 0xff) == (vmeAddr >> 24))
+	return 1;
+  return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Board model (board lock held)
+ */
+
+LOCAL void
+emuDataReset(emuBoard * bd)
+{
+  bd->head = 0;
+  bd->nwords = 0;
+  bd->nevents = 0;
+  bd->blkDone = 0;
+  bd->evCount = 0xffffff;
+}
+
+LOCAL void
+emuSoftReset(emuBoard * bd)
+{
+  bd->bitSet2 = 0;
+  bd->control1 = 0;
+  bd->intLevel = 0;
+  bd->intVector = 0;
+  bd->evTrigger = 0;
+  bd->fsr = 0xff;
+  bd->fclrWindow = 0;
+  bd->slideConst = 0;
+  memset(bd->threshold, 0, sizeof(bd->threshold));
+  emuDataReset(bd);
+}
+
+LOCAL int
+emuNHits(void)
+{
+  int n = emuHits;
+  double l, p, u;
+
+  if (emuHistN > 0)
+    {
+      u = emuUniform();
+      for (n = 0; n < emuHistN - 1; n++)
+	{
+	  if (u < emuHist[n])
+	    break;
+	  u -= emuHist[n];
+	}
+    }
+  else if (emuPoisson)
+    {
+      /* Knuth */
+      l = exp(-(double) emuHits);
+      p = 1.0;
+      n = -1;
+      do
+	{
+	  n++;
+	  p *= emuUniform();
+	}
+      while ((p > l) && (n < C775_MAX_CHANNELS));
+    }
+
+  if (n < 0)
+    n = 0;
+  if (n > C775_MAX_CHANNELS)
+    n = C775_MAX_CHANNELS;
+  return n;
+}
+
+LOCAL void
+emuPush(emuBoard * bd, UINT32 word)
+{
+  bd->fifo[(bd->head + bd->nwords) % EMU_FIFO_WORDS] = word;
+  bd->nwords++;
+}
+
+LOCAL void
+emuGate(emuBoard * bd)
+{
+  int ii, nhits, ch;
+  UINT32 geo = ((UINT32) bd->slot & 0x1f) << 27;
+  UINT32 chmask = 0;
+
+  if (bd->bitSet2 & C775_OFFLINE)
+    return;
+  if (bd->nevents >= EMU_FIFO_EVENTS)
+    {
+      STAT_ADD(lost, 1);
+      return;
+    }
+
+  bd->evCount = (bd->evCount + 1) & 0xffffff;
+  STAT_ADD(triggers, 1);
+
+  nhits = emuNHits();
+  if ((nhits == 0) && !(bd->bitSet2 & C775_INC_HEADER))
+    return;
+
+  /* pick nhits distinct channels, read out in channel order */
+  while (__builtin_popcount(chmask) < nhits)
+    chmask |= 1u << (emuRand() & 0x1f);
+
+  emuPush(bd, geo | C775_HEADER_DATA
+	  | ((UINT32) (bd->crateSelect & 0xff) << 16) | (nhits << 8));
+  for (ii = 0; ii < nhits; ii++)
+    {
+      ch = __builtin_ctz(chmask);
+      chmask &= chmask - 1;
+      emuPush(bd, geo | C775_DATA | (ch << 16) | 0x4000 | (emuRand() & 0xfff));
+    }
+  emuPush(bd, geo | C775_TRAILER_DATA | bd->evCount);
+  bd->nevents++;
+}
+
+/* Deliver any self-timed triggers that are due */
+LOCAL void
+emuAdvance(emuBoard * bd)
+{
+  unsigned long long due;
+  struct timespec t0 = emuRateStart;
+
+  if (emuRate <= 0.0)
+    return;
+  due = (unsigned long long) ((emuNow() - emuNs(&t0)) * 1e-9 * emuRate);
+  while (bd->delivered < due)
+    {
+      emuGate(bd);
+      bd->delivered++;
+    }
+}
+
+/* Pop one word from the output buffer.  Returns 0 if empty */
+LOCAL int
+emuPop(emuBoard * bd, UINT32 * word)
+{
+  if (bd->nwords == 0)
+    return 0;
+  *word = bd->fifo[bd->head];
+  bd->head = (bd->head + 1) % EMU_FIFO_WORDS;
+  bd->nwords--;
+  if ((*word & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
+    bd->nevents--;
+  return 1;
+}
+
+LOCAL UINT16
+emuRegRead(emuBoard * bd, UINT32 off)
+{
+  UINT16 rval = 0;
+
+  emuAdvance(bd);
+  if ((off >= REG(main.threshold)) &&
+      (off < REG(main.threshold) + 2 * C775_MAX_CHANNELS))
+    return bd->threshold[(off - REG(main.threshold)) >> 1];
+
+  switch (off)
+    {
+    case REG(main.rev):
+      return 0x0906;
+    case REG(main.geoAddr):
+      return bd->slot & 0x1f;
+    case REG(main.cbltAddr):
+      return bd->cbltAddr & 0xff;
+    case REG(main.bitSet1):
+    case REG(main.bitClear1):
+      return bd->bitSet1;
+    case REG(main.intLevel):
+      return bd->intLevel;
+    case REG(main.intVector):
+      return bd->intVector;
+    case REG(main.status1):
+      if (bd->nwords)
+	rval |= C775_DATA_READY | 0x2;
+      if (bd->nevents >= EMU_FIFO_EVENTS)
+	rval |= C775_BUSY;
+      if (bd->nevents)
+	rval |= C775_EVRDY;
+      return rval;
+    case REG(main.control1):
+      return bd->control1;
+    case REG(main.aderHigh):
+      return bd->aderHigh;
+    case REG(main.aderLow):
+      return bd->aderLow;
+    case REG(main.cbltControl):
+      return bd->cbltControl & 0x3;
+    case REG(main.evTrigger):
+      return bd->evTrigger;
+    case REG(main.status2):
+      if (bd->nwords == 0)
+	rval |= C775_BUFFER_EMPTY;
+      if (bd->nevents >= EMU_FIFO_EVENTS)
+	rval |= C775_BUFFER_FULL;
+      return rval;
+    case REG(main.evCountL):
+      return bd->evCount & 0xffff;
+    case REG(main.evCountH):
+      return (bd->evCount >> 16) & 0xff;
+    case REG(main.fclrWindow):
+      return bd->fclrWindow;
+    case REG(main.bitSet2):
+    case REG(main.bitClear2):
+      return bd->bitSet2;
+    case REG(main.crateSelect):
+      return bd->crateSelect;
+    case REG(main.fsr):
+      return bd->fsr;
+    case REG(main.slideConst):
+      return bd->slideConst;
+    case REG(rom.OUI_3):
+      return 0x00;
+    case REG(rom.OUI_2):
+      return 0x40;
+    case REG(rom.OUI_1):
+      return 0xe6;
+    case REG(rom.version):
+      return 0xe0;
+    case REG(rom.ID_3):
+      return (C775_BOARD_ID >> 16) & 0xff;
+    case REG(rom.ID_2):
+      return (C775_BOARD_ID >> 8) & 0xff;
+    case REG(rom.ID_1):
+      return C775_BOARD_ID & 0xff;
+    case REG(rom.revision):
+      return 0x01;
+    case REG(rom.serial_msb):
+      return 0x00;
+    case REG(rom.serial_lsb):
+      return (bd->base >> 16) & 0xff;
+    }
+  return 0;
+}
+
+LOCAL void
+emuRegWrite(emuBoard * bd, UINT32 off, UINT16 val)
+{
+  emuAdvance(bd);
+  if ((off >= REG(main.threshold)) &&
+      (off < REG(main.threshold) + 2 * C775_MAX_CHANNELS))
+    {
+      bd->threshold[(off - REG(main.threshold)) >> 1] = val & 0x1ff;
+      return;
+    }
+
+  switch (off)
+    {
+    case REG(main.geoAddr):
+      bd->slot = val & 0x1f;
+      break;
+    case REG(main.cbltAddr):
+      bd->cbltAddr = val & 0xff;
+      break;
+    case REG(main.bitSet1):
+      bd->bitSet1 |= val & 0x98;
+      if (val & C775_SOFT_RESET)
+	emuSoftReset(bd);
+      break;
+    case REG(main.bitClear1):
+      bd->bitSet1 &= ~(val & 0x98);
+      break;
+    case REG(main.intLevel):
+      bd->intLevel = val & C775_INTLEVEL_MASK;
+      break;
+    case REG(main.intVector):
+      bd->intVector = val & C775_INTVECTOR_MASK;
+      break;
+    case REG(main.control1):
+      bd->control1 = val & C775_CONTROL1_MASK;
+      break;
+    case REG(main.aderHigh):
+      bd->aderHigh = val & 0xff;
+      break;
+    case REG(main.aderLow):
+      bd->aderLow = val & 0xff;
+      break;
+    case REG(main.ssReset):
+      emuSoftReset(bd);
+      break;
+    case REG(main.cbltControl):
+      bd->cbltControl = val & 0x3;
+      break;
+    case REG(main.evTrigger):
+      bd->evTrigger = val & C775_EVTRIGGER_MASK;
+      break;
+    case REG(main.incrEvent):
+      {
+	UINT32 w;
+	while (emuPop(bd, &w))
+	  if ((w & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
+	    break;
+      }
+      break;
+    case REG(main.incrOffset):
+      {
+	UINT32 w;
+	emuPop(bd, &w);
+      }
+      break;
+    case REG(main.fclrWindow):
+      bd->fclrWindow = val & 0x3ff;
+      break;
+    case REG(main.bitSet2):
+      bd->bitSet2 |= val & C775_BITSET2_MASK & ~C775_DATA_RESET;
+      if (val & C775_DATA_RESET)
+	emuDataReset(bd);
+      break;
+    case REG(main.bitClear2):
+      bd->bitSet2 &= ~(val & C775_BITSET2_MASK);
+      break;
+    case REG(main.crateSelect):
+      bd->crateSelect = val & 0xff;
+      break;
+    case REG(main.evCountReset):
+      bd->evCount = 0xffffff;
+      break;
+    case REG(main.fsr):
+      bd->fsr = val & C775_FSR_MASK;
+      break;
+    case REG(main.swComm):
+      emuGate(bd);
+      break;
+    case REG(main.slideConst):
+      bd->slideConst = val & 0xff;
+      break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Interrupts.  The 775 holds its IRQ while the buffer holds at least
+ * evTrigger events (RORA), so the handler is re-run until it drains.
+ */
+
+LOCAL void *
+emuIrqLoop(void *arg)
+{
+  int ii, fired, vec, pending;
+  emuBoard *bd;
+  emuIsr isr;
+  struct timespec nap = { 0, 20000 };
+
+  while (emuIrqRunning)
+    {
+      fired = 0;
+      for (ii = 0; ii < emuNBd; ii++)
+	{
+	  bd = emuBd[ii];
+	  pthread_mutex_lock(&bd->lock);
+	  emuAdvance(bd);
+	  pending = (bd->intLevel > 0) && (bd->evTrigger > 0)
+	    && (bd->nevents >= bd->evTrigger);
+	  vec = bd->intVector;
+	  pthread_mutex_unlock(&bd->lock);
+
+	  if (!pending)
+	    continue;
+	  pthread_mutex_lock(&emuMutex);
+	  isr = emuIsrTable[vec];
+	  pthread_mutex_unlock(&emuMutex);
+	  if (isr.routine == NULL)
+	    continue;
+
+	  STAT_ADD(irq, 1);
+	  (*isr.routine) (isr.arg);
+	  fired = 1;
+	}
+      if (!fired)
+	nanosleep(&nap, NULL);
+    }
+  return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Emulator control API
+ */
+
+int
+c775EmuAddBoard(unsigned int vmeAddr, int slot)
+{
+  emuBoard *bd;
+  int a32 = (vmeAddr > 0x00ffffff);
+
+  pthread_mutex_lock(&emuMutex);
+  if ((emuNBd == C775EMU_MAX_BOARDS) || (emuWindowGet(a32, vmeAddr, 1) == NULL))
+    {
+      pthread_mutex_unlock(&emuMutex);
+      return ERROR;
+    }
+
+  bd = (emuBoard *) calloc(1, sizeof(emuBoard));
+  pthread_mutex_init(&bd->lock, NULL);
+  bd->base = vmeAddr & ~(EMU_BOARD_SIZE - 1);
+  bd->slot = slot;
+  emuSoftReset(bd);
+  emuBd[emuNBd] = bd;
+  pthread_mutex_unlock(&emuMutex);
+
+  return emuNBd++;
+}
+
+void
+c775EmuRemoveAll(void)
+{
+  int ii;
+
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < emuNBd; ii++)
+    {
+      pthread_mutex_destroy(&emuBd[ii]->lock);
+      free(emuBd[ii]);
+      emuBd[ii] = NULL;
+    }
+  emuNBd = 0;
+  pthread_mutex_unlock(&emuMutex);
+}
+
+int
+c775EmuNBoards(void)
+{
+  return emuNBd;
+}
+
+void
+c775EmuSetLatency(int cycle_ns, int dma_setup_ns, int dma_word_ns)
+{
+  emuCycleNs = cycle_ns;
+  emuDmaSetupNs = dma_setup_ns;
+  emuDmaWordNs = dma_word_ns;
+}
+
+void
+c775EmuSetRate(double hz)
+{
+  int ii;
+
+  for (ii = 0; ii < emuNBd; ii++)
+    {
+      pthread_mutex_lock(&emuBd[ii]->lock);
+      emuBd[ii]->delivered = 0;
+    }
+  clock_gettime(CLOCK_MONOTONIC, &emuRateStart);
+  emuRate = hz;
+  for (ii = 0; ii < emuNBd; ii++)
+    pthread_mutex_unlock(&emuBd[ii]->lock);
+}
+
+void
+c775EmuSetOccupancy(int nhits, int poisson)
+{
+  emuHits = nhits;
+  emuPoisson = poisson;
+  emuHistN = 0;
+}
+
+void
+c775EmuSetHistogram(const double *prob, int nbins)
+{
+  int ii;
+  double sum = 0.0;
+
+  if (nbins > C775_MAX_CHANNELS + 1)
+    nbins = C775_MAX_CHANNELS + 1;
+  for (ii = 0; ii < nbins; ii++)
+    sum += prob[ii];
+  if (sum <= 0.0)
+    {
+      emuHistN = 0;
+      return;
+    }
+  for (ii = 0; ii < nbins; ii++)
+    emuHist[ii] = prob[ii] / sum;
+  emuHistN = nbins;
+}
+
+/* A bridge that splits a D32 cycle on the D16 registers into two D16
+   cycles (on), or one that passes it to the board, which ends it with
+   BERR (off) */
+void
+c775EmuSetD32Registers(int on)
+{
+  emuD32Regs = on;
+}
+
+void
+c775EmuSetSeed(unsigned int seed)
+{
+  emuSeed = seed;
+}
+
+int
+c775EmuTrigger(int ntrig)
+{
+  int ii, jj;
+
+  for (ii = 0; ii < emuNBd; ii++)
+    {
+      pthread_mutex_lock(&emuBd[ii]->lock);
+      for (jj = 0; jj < ntrig; jj++)
+	emuGate(emuBd[ii]);
+      pthread_mutex_unlock(&emuBd[ii]->lock);
+    }
+  return ntrig;
+}
+
+void
+c775EmuGetStats(c775EmuStats * stats)
+{
+  *stats = emuStats;
+}
+
+void
+c775EmuResetStats(void)
+{
+  memset(&emuStats, 0, sizeof(emuStats));
+}
+
+unsigned long long
+c775EmuCycles(void)
+{
+  return emuStats.read16 + emuStats.read32 + emuStats.write16
+    + emuStats.write32 + emuStats.dma;
+}
+
+/*----------------------------------------------------------------------------
+ * jvme entry points
+ */
+
+/* Crate setup for programs that know nothing about the emulator:
+     C775EMU_BOARDS   = "n[,base[,incr]]"  (base 0x440000, incr 0x10000)
+     C775EMU_RATE     = self-timed trigger rate in Hz
+     C775EMU_LATENCY  = "cycle_ns[,dma_setup_ns[,dma_word_ns]]"
+     C775EMU_HITS     = "nhits[,poisson]"
+     C775EMU_D32REGS  = 0 for BERR on D32 register cycles                 */
+LOCAL void
+emuConfigFromEnv(void)
+{
+  char *env;
+  int ii, n = 0, lat[3] = { 0, 0, 0 }, hits = emuHits, poisson = 0;
+  unsigned int base = 0x440000, incr = 0x10000;
+
+  if ((env = getenv("C775EMU_LATENCY")) != NULL)
+    {
+      sscanf(env, "%d,%d,%d", &lat[0], &lat[1], &lat[2]);
+      c775EmuSetLatency(lat[0], lat[1], lat[2]);
+    }
+  if ((env = getenv("C775EMU_HITS")) != NULL)
+    {
+      sscanf(env, "%d,%d", &hits, &poisson);
+      c775EmuSetOccupancy(hits, poisson);
+    }
+  if ((emuNBd == 0) && ((env = getenv("C775EMU_BOARDS")) != NULL))
+    {
+      sscanf(env, "%d,%i,%i", &n, &base, &incr);
+      for (ii = 0; ii < n; ii++)
+	c775EmuAddBoard(base + ii * incr, 2 + ii);
+    }
+  if ((env = getenv("C775EMU_RATE")) != NULL)
+    c775EmuSetRate(atof(env));
+  if ((env = getenv("C775EMU_D32REGS")) != NULL)
+    c775EmuSetD32Registers(atoi(env));
+}
+
+int
+logMsg(const char *fmt, ...)
+{
+  va_list args;
+  int rval;
+
+  va_start(args, fmt);
+  rval = vprintf(fmt, args);
+  va_end(args);
+  return rval;
+}
+
+STATUS
+vmeOpenDefaultWindows(void)
+{
+  pthread_mutex_lock(&emuMutex);
+  emuWindowGet(0, 0, 1);
+  pthread_mutex_unlock(&emuMutex);
+  emuConfigFromEnv();
+  return OK;
+}
+
+STATUS
+vmeCloseDefaultWindows(void)
+{
+  int ii;
+
+  if (emuIrqRunning)
+    {
+      emuIrqRunning = 0;
+      pthread_join(emuIrqThread, NULL);
+    }
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < emuNWin; ii++)
+    munmap(emuWin[ii].local, EMU_WIN_SIZE);
+  emuNWin = 0;
+  pthread_mutex_unlock(&emuMutex);
+  return OK;
+}
+
+void
+vmeSetQuietFlag(UINT32 pflag)
+{
+}
+
+int
+vmeBusToLocalAdrs(int vmeAdrsSpace, char *vmeBusAdrs, char **pLocalAdrs)
+{
+  UINT32 vmeAddr = (UINT32) (unsigned long) vmeBusAdrs;
+  int a32;
+  emuWindow *w;
+
+  switch (vmeAdrsSpace)
+    {
+    case 0x39: case 0x3d: case 0x3b: case 0x3f:
+      a32 = 0;
+      break;
+    case 0x09: case 0x0d: case 0x0b: case 0x0f:
+      a32 = 1;
+      break;
+    default:
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&emuMutex);
+  w = emuWindowGet(a32, vmeAddr, 1);
+  pthread_mutex_unlock(&emuMutex);
+  if (w == NULL)
+    return ERROR;
+
+  *pLocalAdrs = w->local + (vmeAddr - w->vmeBase);
+  return OK;
+}
+
+int
+vmeMemProbe(char *addr, UINT32 size, char *rval)
+{
+  UINT32 vmeAddr, off, val32;
+  emuBoard *bd;
+  UINT16 val;
+
+  emuCycle();
+  if (size == 4)
+    STAT_ADD(read32, 1);
+  else
+    STAT_ADD(read16, 1);
+  if ((emuLocalToVme(addr, &vmeAddr) < 0)
+      || ((bd = emuBoardAt(vmeAddr, &off)) == NULL))
+    return ERROR;
+  if ((size == 4) && !emuD32Regs && (off >= REG(blank1)))
+    return ERROR;
+
+  pthread_mutex_lock(&bd->lock);
+  val = emuRegRead(bd, off);
+  val32 = ((UINT32) val << 16) | emuRegRead(bd, off + 2);
+  pthread_mutex_unlock(&bd->lock);
+  if (size == 4)
+    memcpy(rval, &val32, 4);
+  else
+    memcpy(rval, &val, (size < 2) ? size : 2);
+  return OK;
+}
+
+UINT16
+vmeRead16(volatile UINT16 * addr)
+{
+  UINT32 vmeAddr, off, w;
+  emuBoard *bd;
+  UINT16 rval = 0xffff;
+
+  emuCycle();
+  STAT_ADD(read16, 1);
+  if ((emuLocalToVme(addr, &vmeAddr) < 0)
+      || ((bd = emuBoardAt(vmeAddr, &off)) == NULL))
+    return rval;
+
+  pthread_mutex_lock(&bd->lock);
+  if (off < REG(blank1))
+    {
+      /* D16 access to the output buffer pops a word */
+      rval = emuPop(bd, &w) ? (w >> 16) : (C775_INVALID_DATA >> 16);
+    }
+  else
+    rval = emuRegRead(bd, off);
+  pthread_mutex_unlock(&bd->lock);
+  return rval;
+}
+
+UINT32
+vmeRead32(volatile UINT32 * addr)
+{
+  UINT32 vmeAddr, off, rval = 0xffffffff;
+  emuBoard *bd;
+
+  emuCycle();
+  STAT_ADD(read32, 1);
+  if ((emuLocalToVme(addr, &vmeAddr) < 0)
+      || ((bd = emuBoardAt(vmeAddr, &off)) == NULL))
+    return rval;
+
+  pthread_mutex_lock(&bd->lock);
+  if (off < REG(blank1))
+    {
+      emuAdvance(bd);
+      if (!emuPop(bd, &rval))
+	rval = C775_INVALID_DATA;
+    }
+  else if (emuD32Regs)
+    {
+      /* Big endian bus: lower address in the upper half */
+      rval = ((UINT32) emuRegRead(bd, off) << 16) | emuRegRead(bd, off + 2);
+    }
+  pthread_mutex_unlock(&bd->lock);
+  return rval;
+}
+
+void
+vmeWrite16(volatile UINT16 * addr, UINT16 val)
+{
+  UINT32 vmeAddr, off;
+  emuBoard *bd;
+  int ii;
+
+  emuCycle();
+  STAT_ADD(write16, 1);
+  if (emuLocalToVme(addr, &vmeAddr) < 0)
+    return;
+
+  if ((bd = emuBoardAt(vmeAddr, &off)) != NULL)
+    {
+      pthread_mutex_lock(&bd->lock);
+      emuRegWrite(bd, off, val);
+      pthread_mutex_unlock(&bd->lock);
+      return;
+    }
+
+  if (emuIsMcst(vmeAddr))
+    {
+      /* Multicast: every board in the chain latches the same cycle */
+      STAT_ADD(mcst, 1);
+      for (ii = 0; ii < emuNBd; ii++)
+	{
+	  bd = emuBd[ii];
+	  if (!(bd->cbltControl & 0x3)
+	      || ((bd->cbltAddr & 0xff) != (vmeAddr >> 24)))
+	    continue;
+	  pthread_mutex_lock(&bd->lock);
+	  emuRegWrite(bd, vmeAddr & 0xffff, val);
+	  pthread_mutex_unlock(&bd->lock);
+	}
+    }
+}
+
+void
+vmeWrite32(volatile UINT32 * addr, UINT32 val)
+{
+  UINT32 vmeAddr, off;
+  emuBoard *bd;
+
+  emuCycle();
+  STAT_ADD(write32, 1);
+  if ((emuLocalToVme(addr, &vmeAddr) < 0)
+      || ((bd = emuBoardAt(vmeAddr, &off)) == NULL))
+    return;
+
+  pthread_mutex_lock(&bd->lock);
+  emuRegWrite(bd, off, val >> 16);
+  emuRegWrite(bd, off + 2, val & 0xffff);
+  pthread_mutex_unlock(&bd->lock);
+}
+
+int
+vmeBusLock(void)
+{
+  return pthread_mutex_lock(&emuUserBusMutex);
+}
+
+int
+vmeBusUnlock(void)
+{
+  return pthread_mutex_unlock(&emuUserBusMutex);
+}
+
+int
+vmeDmaConfig(UINT32 addrType, UINT32 dataType, UINT32 sstMode)
+{
+  return OK;
+}
+
+/* Move up to max words from one board.  Sets *berr if the board ended the
+   cycle with a bus error. Board lock held. */
+LOCAL int
+emuDmaBoard(emuBoard * bd, volatile UINT32 * dst, int max, int *berr)
+{
+  int n = 0;
+  UINT32 w;
+
+  emuAdvance(bd);
+  bd->blkDone = 0;
+  while (n < max)
+    {
+      if (bd->blkDone || (bd->nwords == 0))
+	{
+	  if (bd->control1 & C775_BERR_ENABLE)
+	    {
+	      *berr = 1;
+	      break;
+	    }
+	  w = C775_INVALID_DATA;
+	}
+      else
+	{
+	  emuPop(bd, &w);
+	  if ((bd->control1 & C775_BLK_END)
+	      && ((w & C775_DATA_ID_MASK) == C775_TRAILER_DATA))
+	    bd->blkDone = 1;
+	}
+      /* Data lands in bus (big endian) byte order */
+      dst[n++] = LSWAP(w);
+    }
+  return n;
+}
+
+int
+vmeDmaSend(unsigned long locAdrs, UINT32 vmeAdrs, int size)
+{
+  volatile UINT32 *dst = (volatile UINT32 *) locAdrs;
+  int ii, n = 0, max = size >> 2, berr = 0, chain = 0;
+  UINT32 off;
+  emuBoard *bd, *order[C775EMU_MAX_BOARDS];
+  long long start = emuNow();
+
+  /* Like the bridge, only DMA memory can be a destination */
+  if ((size <= 0) || (vmeDmaLocalToPhysAdrs(locAdrs) == 0)
+      || (vmeDmaLocalToPhysAdrs(locAdrs + size - 1) == 0))
+    return ERROR;
+
+  STAT_ADD(dma, 1);
+
+  if ((bd = emuBoardAt(vmeAdrs, &off)) != NULL)
+    {
+      if (off >= REG(blank1))
+	{
+	  emuDmaResult = ERROR;
+	  return OK;
+	}
+      pthread_mutex_lock(&bd->lock);
+      n = emuDmaBoard(bd, dst, max, &berr);
+      if (berr)
+	bd->bitSet1 |= C775_VME_BUS_ERROR;
+      pthread_mutex_unlock(&bd->lock);
+    }
+  else if (emuIsMcst(vmeAdrs) && ((vmeAdrs & 0x00ffffff) == 0))
+    {
+      /* CBLT: token passes in slot order, the last board ends with BERR */
+      for (ii = 0; ii < emuNBd; ii++)
+	if ((emuBd[ii]->cbltControl & 0x3)
+	    && ((emuBd[ii]->cbltAddr & 0xff) == (vmeAdrs >> 24)))
+	  order[chain++] = emuBd[ii];
+      for (ii = 1; ii < chain; ii++)
+	{
+	  int jj = ii;
+	  while ((jj > 0) && (order[jj - 1]->slot > order[jj]->slot))
+	    {
+	      bd = order[jj];
+	      order[jj] = order[jj - 1];
+	      order[jj - 1] = bd;
+	      jj--;
+	    }
+	}
+      for (ii = 0; (ii < chain) && (n < max); ii++)
+	{
+	  int b = 0;
+	  UINT16 save;
+
+	  bd = order[ii];
+	  pthread_mutex_lock(&bd->lock);
+	  /* within the chain every board passes the token instead of BERR */
+	  save = bd->control1;
+	  bd->control1 |= C775_BERR_ENABLE;
+	  n += emuDmaBoard(bd, &dst[n], max - n, &b);
+	  bd->control1 = save;
+	  if (b && ((bd->cbltControl & 0x3) == 0x1))
+	    {
+	      bd->bitSet1 |= C775_VME_BUS_ERROR;
+	      berr = 1;
+	    }
+	  pthread_mutex_unlock(&bd->lock);
+	}
+    }
+  else
+    {
+      emuDmaResult = ERROR;
+      return OK;
+    }
+
+  STAT_ADD(dmaWords, n);
+  emuDmaResult = n << 2;
+  start += emuDmaSetupNs + (long long) n *emuDmaWordNs;
+  emuDmaEnd.tv_sec = start / 1000000000LL;
+  emuDmaEnd.tv_nsec = start % 1000000000LL;
+  return OK;
+}
+
+int
+vmeDmaDone(void)
+{
+  struct timespec end = emuDmaEnd;
+
+  if (emuDmaSetupNs || emuDmaWordNs)
+    {
+      pthread_mutex_lock(&emuBusMutex);
+      emuSpin(emuNs(&end) - emuNow());
+      pthread_mutex_unlock(&emuBusMutex);
+    }
+  return emuDmaResult;
+}
+
+int
+vmeIntConnect(UINT32 vector, UINT32 level, VOIDFUNCPTR routine, UINT32 arg)
+{
+  if (vector >= EMU_MAX_VECTORS)
+    return ERROR;
+
+  pthread_mutex_lock(&emuMutex);
+  emuIsrTable[vector].routine = routine;
+  emuIsrTable[vector].arg = arg;
+  emuIsrTable[vector].level = level;
+  if (!emuIrqRunning)
+    {
+      emuIrqRunning = 1;
+      pthread_create(&emuIrqThread, NULL, emuIrqLoop, NULL);
+    }
+  pthread_mutex_unlock(&emuMutex);
+  return OK;
+}
+
+int
+vmeIntDisconnect(UINT32 level)
+{
+  int ii;
+
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < EMU_MAX_VECTORS; ii++)
+    if (emuIsrTable[ii].level == level)
+      emuIsrTable[ii].routine = NULL;
+  pthread_mutex_unlock(&emuMutex);
+  return OK;
+}
+
+/*----------------------------------------------------------------------------
+ * DMA memory partitions
+ */
+
+DMA_MEM_ID
+dmaPCreate(char *name, int size, int c, int incr)
+{
+  DMA_MEM_ID part;
+  int ii, nodesize = (sizeof(DMANODE) + size + 63) & ~63;
+  char *mem;
+
+  mem = mmap(NULL, (size_t) nodesize * c, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+  if (mem == MAP_FAILED)
+    return NULL;
+
+  part = (DMA_MEM_ID) calloc(1, sizeof(ROL_MEM_PART));
+  strncpy(part->name, name, sizeof(part->name) - 1);
+  part->size = size;
+  part->incr = nodesize;
+  part->total = c;
+  part->base = mem;
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < EMU_MAX_PARTS; ii++)
+    if (emuPart[ii] == NULL)
+      {
+	emuPart[ii] = part;
+	break;
+      }
+  pthread_mutex_unlock(&emuMutex);
+  for (ii = c - 1; ii >= 0; ii--)
+    {
+      DMANODE *node = (DMANODE *) (mem + (size_t) ii * nodesize);
+      node->part = part;
+      node->n = part->free;
+      part->free = node;
+    }
+  return part;
+}
+
+void
+dmaPFree(DMA_MEM_ID pPart)
+{
+  int ii;
+
+  if (pPart == NULL)
+    return;
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < EMU_MAX_PARTS; ii++)
+    if (emuPart[ii] == pPart)
+      emuPart[ii] = NULL;
+  pthread_mutex_unlock(&emuMutex);
+  munmap(pPart->base, (size_t) pPart->incr * pPart->total);
+  free(pPart);
+}
+
+void
+dmaPFreeAll(void)
+{
+  int ii;
+
+  for (ii = 0; ii < EMU_MAX_PARTS; ii++)
+    dmaPFree(emuPart[ii]);
+}
+
+/* Physical address of DMA memory (identity here), 0 outside of it */
+unsigned long
+vmeDmaLocalToPhysAdrs(unsigned long locAdrs)
+{
+  int ii;
+  unsigned long base, rval = 0;
+
+  pthread_mutex_lock(&emuMutex);
+  for (ii = 0; ii < EMU_MAX_PARTS; ii++)
+    {
+      if (emuPart[ii] == NULL)
+	continue;
+      base = (unsigned long) emuPart[ii]->base;
+      if ((locAdrs >= base)
+	  && (locAdrs < base + (unsigned long) emuPart[ii]->incr
+	      * emuPart[ii]->total))
+	{
+	  rval = locAdrs;
+	  break;
+	}
+    }
+  pthread_mutex_unlock(&emuMutex);
+  return rval;
+}
+
+int
+dmaPReInitAll(void)
+{
+  return OK;
+}
+
+DMANODE *
+dmaPGetItem(DMA_MEM_ID pPart)
+{
+  DMANODE *node;
+
+  pthread_mutex_lock(&emuMutex);
+  node = pPart->free;
+  if (node)
+    pPart->free = node->n;
+  pthread_mutex_unlock(&emuMutex);
+  if (node)
+    {
+      node->n = NULL;
+      node->length = 0;
+      node->nevent = 0;
+    }
+  return node;
+}
+
+void
+dmaPFreeItem(DMANODE * pItem)
+{
+  DMA_MEM_ID part = pItem->part;
+
+  pthread_mutex_lock(&emuMutex);
+  pItem->n = part->free;
+  part->free = pItem;
+  pthread_mutex_unlock(&emuMutex);
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+*
+*  c775Emu.h  -  In-process software emulator of C.A.E.N. Model 775 TDCs on a
+*                VME bus.  Provides the jvme entry points used by libc775
+*                (see jvme.h in this directory) on top of an emulated
+*                c775_regs register map, so that the library, its test
+*                programs and readout lists can be run and profiled on a
+*                host without a VME controller.
+*
+*  Emulated:  output buffer FIFO (32 events of header/data/trailer words),
+*             status1/status2 bits, 24-bit event counter, bit set/clear
+*             registers, soft and data reset, BERR terminated block reads,
+*             CBLT and MCST, ROM board ID/serial/revision, RORA interrupts
+*             on the evTrigger threshold.
+*
+*  Timing:    every single cycle (D16/D32) costs cycle_ns, every DMA costs
+*             dma_setup_ns + dma_word_ns per longword.  Triggers are either
+*             issued explicitly (c775EmuTrigger) or self-timed at a fixed
+*             rate (c775EmuSetRate).
+*
+*  Programs that do not call the c775Emu API (drgTst, readout lists) can
+*  describe the crate in the environment, read by vmeOpenDefaultWindows():
+*     C775EMU_BOARDS   = "n[,base[,incr]]"   n TDCs in slots 2,3,...
+*                                            (default base 0x440000,
+*                                             incr 0x10000)
+*     C775EMU_RATE     = trigger rate in Hz
+*     C775EMU_LATENCY  = "cycle_ns[,dma_setup_ns[,dma_word_ns]]"
+*     C775EMU_HITS     = "nhits[,poisson]"  hits per TDC per event
+*     C775EMU_D32REGS  = 0                  D32 cycles on the (D16)
+*                                            registers end with BERR
+*
+*  Build:  make -C c775/emu          ->  libc775emu.a (libc775 + emulator)
+*          make -C c775/test EMU=1   ->  test programs linked against it
+*
+*/
+#ifndef __C775EMU__
+#define __C775EMU__
+
+#define C775EMU_MAX_BOARDS   64
+
+typedef struct c775EmuStats_struct
+{
+  unsigned long long read16;	/* D16 read cycles */
+  unsigned long long read32;	/* D32 read cycles */
+  unsigned long long write16;	/* D16 write cycles */
+  unsigned long long write32;	/* D32 write cycles */
+  unsigned long long mcst;	/* Multicast write cycles (subset of write16) */
+  unsigned long long dma;	/* DMA transfers started */
+  unsigned long long dmaWords;	/* Longwords moved by DMA */
+  unsigned long long irq;	/* Interrupts delivered */
+  unsigned long long triggers;	/* Gates accepted (summed over boards) */
+  unsigned long long lost;	/* Gates dropped with a full buffer */
+} c775EmuStats;
+
+/* Crate setup */
+int  c775EmuAddBoard(unsigned int vmeAddr, int slot);
+void c775EmuRemoveAll(void);
+int  c775EmuNBoards(void);
+
+/* Timing model */
+void c775EmuSetLatency(int cycle_ns, int dma_setup_ns, int dma_word_ns);
+void c775EmuSetRate(double hz);
+void c775EmuSetD32Registers(int on);
+
+/* Event model */
+void c775EmuSetOccupancy(int nhits, int poisson);
+void c775EmuSetHistogram(const double *prob, int nbins);
+void c775EmuSetSeed(unsigned int seed);
+int  c775EmuTrigger(int ntrig);
+
+/* Counters */
+void c775EmuGetStats(c775EmuStats * stats);
+void c775EmuResetStats(void);
+unsigned long long c775EmuCycles(void);
+
+#endif /* __C775EMU__ */
@@ -0,0 +1,105 @@
+/******************************************************************************
+*
+*  jvme.h  -  Stand-in for the JLab jvme library header, used to build
+*             libc775 against the in-process c775 VME emulator (c775Emu.c)
+*             on hosts without a VME controller.
+*
+*             Only the subset of jvme used by the c775 library, its test
+*             programs and the readout lists is declared here.  Everything
+*             is implemented by c775Emu.c.
+*
+*/
+#ifndef __JVME_EMU__
+#define __JVME_EMU__
+
+#include <stdio.h>
+#include <pthread.h>
+
+#ifndef OK
+#define OK     0
+#endif
+#ifndef ERROR
+#define ERROR -1
+#endif
+#ifndef TRUE
+#define TRUE   1
+#endif
+#ifndef FALSE
+#define FALSE  0
+#endif
+#ifndef LOCAL
+#define LOCAL static
+#endif
+
+typedef int            STATUS;
+typedef int            BOOL;
+typedef unsigned int   UINT32;
+typedef int            INT32;
+typedef unsigned short UINT16;
+typedef short          INT16;
+typedef unsigned char  UINT8;
+typedef void         (*VOIDFUNCPTR) ();
+typedef int          (*FUNCPTR) ();
+
+#define LSWAP(x) ((((x) & 0x000000ff) << 24) |	\
+		  (((x) & 0x0000ff00) <<  8) |	\
+		  (((x) & 0x00ff0000) >>  8) |	\
+		  (((x) & 0xff000000) >> 24))
+#define SSWAP(x) ((((x) & 0x00ff) << 8) | (((x) & 0xff00) >> 8))
+
+/* vxWorks style: format plus six arguments, the unused ones are 0 */
+int logMsg(const char *fmt, ...);
+
+/* VME Window / Bus access */
+STATUS vmeOpenDefaultWindows(void);
+STATUS vmeCloseDefaultWindows(void);
+void   vmeSetQuietFlag(UINT32 pflag);
+int    vmeBusToLocalAdrs(int vmeAdrsSpace, char *vmeBusAdrs, char **pLocalAdrs);
+int    vmeMemProbe(char *addr, UINT32 size, char *rval);
+UINT16 vmeRead16(volatile UINT16 * addr);
+UINT32 vmeRead32(volatile UINT32 * addr);
+void   vmeWrite16(volatile UINT16 * addr, UINT16 val);
+void   vmeWrite32(volatile UINT32 * addr, UINT32 val);
+int    vmeBusLock(void);
+int    vmeBusUnlock(void);
+
+/* DMA */
+int    vmeDmaConfig(UINT32 addrType, UINT32 dataType, UINT32 sstMode);
+int    vmeDmaSend(unsigned long locAdrs, UINT32 vmeAdrs, int size);
+int    vmeDmaDone(void);
+unsigned long vmeDmaLocalToPhysAdrs(unsigned long locAdrs);
+
+/* Interrupts */
+int    vmeIntConnect(UINT32 vector, UINT32 level, VOIDFUNCPTR routine,
+		     UINT32 arg);
+int    vmeIntDisconnect(UINT32 level);
+
+/* DMA memory partitions (subset of dmaPList.h) */
+typedef struct dmanode
+{
+  struct dmanode *n;
+  struct dmanode *p;
+  struct rol_mem_part *part;
+  unsigned int length;
+  int nevent;
+  volatile unsigned int data[1];
+} DMANODE;
+
+typedef struct rol_mem_part
+{
+  char name[40];
+  int size;
+  int incr;
+  int total;
+  DMANODE *free;
+  char *base;
+} ROL_MEM_PART, *ROL_MEM_ID, *DMA_MEM_ID;
+
+DMA_MEM_ID dmaPCreate(char *name, int size, int c, int incr);
+void       dmaPFree(DMA_MEM_ID pPart);
+void       dmaPFreeAll(void);
+int        dmaPReInitAll(void);
+DMANODE   *dmaPGetItem(DMA_MEM_ID pPart);
+void       dmaPFreeItem(DMANODE * pItem);
+
+#endif /* __JVME_EMU__ */
@@ -0,0 +1,666 @@
+/*
+ * File:
+ *    c775Bench.c
+ *
+ * Description:
+ *    Readout throughput benchmark for libc775.  For every readout mode
+ *    the benchmark sweeps the number of TDCs, the number of hits per TDC
+ *    per event and the number of events collected before each readout.
+ *    Each point triggers that many events, then times the readout of all
+ *    TDCs, and reports:
+ *
+ *       events/s   - triggers read out per second of readout time
+ *       MB/s       - data moved per second of readout time
+ *       cyc/ev     - VME cycles (single cycles + DMA transfers) per trigger,
+ *                    as counted by the library (c775GetBusCycles)
+ *       p50, p99   - latency of one readout of all TDCs, in microseconds
+ *
+ *    Readout modes:
+ *       pio        c775ReadEvent, one event at a time
+ *       block      c775ReadBlock, one BERR terminated DMA per TDC
+ *       events     c775ReadEvents, as block plus the event index
+ *       cblt       c775ReadCBLT, one chained DMA for the crate (>= 2 TDCs)
+ *       async      c775ReadBlockStart/Wait, the next TDC's DMA overlaps
+ *                  the processing of the current one
+ *       irq        c775IntRingRead/Wait, the interrupt handler drains the
+ *                  TDCs into the readout ring (every TDC interrupts on
+ *                  its own vector, every ev/rd events).  The handler's
+ *                  bus cycles are not made by the reading thread and do
+ *                  not show in cyc/ev.
+ *       epoll      epoll_wait on the interrupt eventfd (c775IntEventFd),
+ *                  then c775ReadEvents of the TDCs that interrupted
+ *
+ *    Built with EMU=1 the TDCs, the event sizes and the bus timing come
+ *    from the emulator (../emu), with a fixed random seed, so that results
+ *    can be compared between versions of the library.  The default bus
+ *    timing can be overridden with C775EMU_LATENCY.  On hardware, events
+ *    are made with software gates and their size is whatever the inputs
+ *    give (the hits column shows "-").
+ *
+ *    After the sweep, the bus cycles of one call of each readiness check
+ *    and readout function are listed, for a TDC holding a few events,
+ *    followed by the cost of starting up a crate of the largest number
+ *    of TDCs: c775Init, and c775Discover with and without the MCST setup,
+ *    then of loading thresholds into all of its TDCs: the same pedestals
+ *    for every TDC, different ones, and the same load again.
+ *
+ *    With -l, the emulator's trigger rate is stepped up and down again
+ *    while the irq readout runs with an adaptive event threshold
+ *    (c775IntSetAdaptive) under the given latency ceiling, and the
+ *    threshold chosen and the interrupts per second are listed.
+ *
+ *    With -s the library swaps block read data to CPU byte order right
+ *    after each DMA (c775SetBlockSwap), instead of leaving it in VME byte
+ *    order.
+ *
+ *    usage: c775Bench [-n reads per point] [-b max TDCs] [-m mode] [-s]
+ *                     [-l latency ceiling us]
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include "jvme.h"
+#include "c775Lib.h"
+#ifdef C775_EMU
+#include "c775Emu.h"
+#endif
+
+#define TDC0_BASE_ADDR         0x00440000
+#define TDC_BASE_INCR          0x010000
+#define CBLT_ADDR              0xAA000000
+#define CRATE_ID               0
+
+/* Room for a full output buffer plus the BERR, so that every block read
+   is ended by the TDC */
+#define BLOCK_WORDS            (C775_MAX_BLOCK_WORDS + 2)
+
+/* Default emulated bus timing (ns): D16/D32 cycle, DMA setup, DMA word */
+#define EMU_CYCLE_NS           500
+#define EMU_DMA_SETUP_NS       5000
+#define EMU_DMA_WORD_NS        100
+
+#define MODE_PIO     0
+#define MODE_BLOCK   1
+#define MODE_EVENTS  2
+#define MODE_CBLT    3
+#define MODE_ASYNC   4
+#define MODE_IRQ     5
+#define MODE_EPOLL   6
+#define NMODES       7
+
+/* Buffers of the interrupt readout ring */
+#define RING_SLOTS   16
+
+static const char *modeName[NMODES] =
+  { "pio", "block", "events", "cblt", "async", "irq", "epoll" };
+
+static const int boardList[] = { 1, 2, 4, 8, 16 };
+static const int evList[] = { 1, 4, 16, 32 };
+#ifdef C775_EMU
+static const int hitList[] = { 1, 8, 32 };
+#else
+static const int hitList[] = { -1 };
+#endif
+
+extern int Nc775;
+extern UINT32 c775CBLTAdr;
+
+#define NELEM(x) ((int) (sizeof(x) / sizeof((x)[0])))
+
+static FILE *out;
+static int blockSwap = 0;
+static volatile UINT32 *buf, *abuf[2], *rbuf[RING_SLOTS];
+static c775_evindex evIndex;
+static c775_cbltindex cbltIndex;
+static int epfd = -1;
+
+static double
+now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static int
+cmpDouble(const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/* Number of headers in a block of DMA data */
+static int
+countEvents(volatile UINT32 * data, int nwrds)
+{
+  int ii, nev = 0;
+  UINT32 word;
+
+  for (ii = 0; ii < nwrds; ii++)
+    {
+      word = blockSwap ? data[ii] : LSWAP(data[ii]);
+      if ((word & C775_DATA_ID_MASK) == C775_HEADER_DATA)
+	nev++;
+    }
+  return nev;
+}
+
+/* Make nev events in every TDC */
+static void
+trigger(int nev)
+{
+#ifdef C775_EMU
+  c775EmuTrigger(nev);
+#else
+  int ii;
+  for (ii = 0; ii < nev; ii++)
+    c775GateAll();
+#endif
+}
+
+/* Set up ntdc TDCs.  Returns OK, or ERROR */
+static int
+setupCrate(int ntdc)
+{
+  int ii;
+
+  if (c775CBLTAdr != 0)
+    c775CBLTDisable();
+
+#ifdef C775_EMU
+  c775EmuRemoveAll();
+  for (ii = 0; ii < ntdc; ii++)
+    c775EmuAddBoard(TDC0_BASE_ADDR + ii * TDC_BASE_INCR, 2 + ii);
+#endif
+
+  if (c775Init(TDC0_BASE_ADDR, TDC_BASE_INCR, ntdc, CRATE_ID) == ERROR)
+    return ERROR;
+  if (Nc775 != ntdc)
+    return ERROR;
+
+  for (ii = 0; ii < ntdc; ii++)
+    {
+      c775EnableBerr(ii);
+      c775Clear(ii);
+    }
+
+  if (ntdc >= 2)
+    c775CBLTInit(CBLT_ADDR);
+
+  return OK;
+}
+
+/* One readout of all TDCs.  Returns the events read, words in *nwrds */
+static int
+readout(int mode, int ntdc, int nev, int *nwrds)
+{
+  int id, ii, nw, n = 0;
+  unsigned int pending;
+  volatile UINT32 *data;
+  struct epoll_event ev;
+
+  *nwrds = 0;
+  switch (mode)
+    {
+    case MODE_PIO:
+      for (id = 0; id < ntdc; id++)
+	for (ii = 0; ii < nev; ii++)
+	  {
+	    nw = c775ReadEvent(id, (UINT32 *) buf);
+	    if (nw <= 0)
+	      break;
+	    *nwrds += nw;
+	    n++;
+	  }
+      break;
+
+    case MODE_BLOCK:
+      for (id = 0; id < ntdc; id++)
+	{
+	  nw = c775ReadBlock(id, buf, BLOCK_WORDS);
+	  if (nw <= 0)
+	    continue;
+	  *nwrds += nw;
+	  n += countEvents(buf, nw);
+	}
+      break;
+
+    case MODE_EVENTS:
+      for (id = 0; id < ntdc; id++)
+	{
+	  if (c775ReadEvents(id, buf, BLOCK_WORDS, &evIndex) <= 0)
+	    continue;
+	  *nwrds += evIndex.nwords;
+	  n += evIndex.nevents;
+	}
+      break;
+
+    case MODE_CBLT:
+      nw = c775ReadCBLT(buf, ntdc * BLOCK_WORDS, &cbltIndex);
+      if (nw <= 0)
+	break;
+      *nwrds = nw;
+      for (id = 0; id < ntdc; id++)
+	n += cbltIndex.nevents[id];
+      break;
+
+    case MODE_ASYNC:
+      if (c775ReadBlockStart(0, BLOCK_WORDS) < 0)
+	break;
+      for (id = 0; id < ntdc; id++)
+	{
+	  nw = c775ReadBlockWait(&data);
+	  if (id + 1 < ntdc)
+	    c775ReadBlockStart(id + 1, BLOCK_WORDS);
+	  if (nw > 0)
+	    {
+	      *nwrds += nw;
+	      n += countEvents(data, nw);
+	    }
+	  c775ReadBlockRelease(data);
+	}
+      break;
+
+    case MODE_IRQ:
+      while (n < nev * ntdc)
+	{
+	  nw = c775IntRingRead((UINT32 *) buf, BLOCK_WORDS, NULL);
+	  if (nw < 0)
+	    break;
+	  if (nw == 0)
+	    {
+	      if (c775IntRingWait(100) <= 0)
+		break;
+	      continue;
+	    }
+	  *nwrds += nw;
+	  n++;
+	}
+      break;
+
+    case MODE_EPOLL:
+      while (n < nev * ntdc)
+	{
+	  if (epoll_wait(epfd, &ev, 1, 100) <= 0)
+	    break;
+	  pending = c775IntEventFdTake();
+	  for (id = 0; pending != 0; id++, pending >>= 1)
+	    {
+	      if (!(pending & 1))
+		continue;
+	      if (c775ReadEvents(id, buf, BLOCK_WORDS, &evIndex) > 0)
+		{
+		  *nwrds += evIndex.nwords;
+		  n += evIndex.nevents;
+		}
+	      c775IntRearm(id);
+	    }
+	}
+      break;
+    }
+
+  return n;
+}
+
+static void
+runPoint(int mode, int ntdc, int nhits, int nev, int nread, double *lat)
+{
+  int ii, nw, nevts = 0, bad = 0;
+  double t0, ttot = 0, words = 0, cycles = 0;
+  unsigned int c0;
+  char hits[16];
+
+#ifdef C775_EMU
+  c775EmuSetOccupancy(nhits, 0);
+  c775EmuSetSeed(0x775);
+#endif
+
+  if ((mode == MODE_IRQ) || (mode == MODE_EPOLL))
+    {
+      /* Every TDC interrupts, on its own vector, once per readout.  With
+         no ring, the handler only wakes the eventfd. */
+      if (mode == MODE_IRQ)
+	c775IntRingInit(RING_SLOTS, rbuf, BLOCK_WORDS);
+      else
+	c775IntRingInit(0, NULL, 0);
+      for (ii = 0; ii < ntdc; ii++)
+	{
+	  c775IntConnectBoard(ii, NULL, 0, 0, 0);
+	  c775IntEnableBoard(ii, (nev > 31) ? 31 : nev);
+	}
+    }
+
+  for (ii = 0; ii < nread; ii++)
+    {
+      trigger(nev);
+      c0 = c775GetBusCycles();
+      t0 = now();
+      nevts = readout(mode, ntdc, nev, &nw);
+      lat[ii] = now() - t0;
+      cycles += c775GetBusCycles() - c0;
+      ttot += lat[ii];
+      words += nw;
+      if (nevts != nev * ntdc)
+	bad++;
+    }
+
+  if ((mode == MODE_IRQ) || (mode == MODE_EPOLL))
+    for (ii = 0; ii < ntdc; ii++)
+      c775IntDisableBoard(ii);
+
+  qsort(lat, nread, sizeof(double), cmpDouble);
+
+  if (nhits < 0)
+    strcpy(hits, "-");
+  else
+    sprintf(hits, "%d", nhits);
+
+  fprintf(out, "  %-7s %5d %5s %6d %12.0f %9.2f %9.1f %9.1f %9.1f%s\n",
+	  modeName[mode], ntdc, hits, nev,
+	  (double) nread * nev / ttot,
+	  words * 4 / ttot / 1e6,
+	  cycles / ((double) nread * nev),
+	  1e6 * lat[nread / 2], 1e6 * lat[(nread * 99) / 100],
+	  bad ? "  (short reads)" : "");
+  fflush(out);
+}
+
+#ifdef C775_EMU
+/* Adaptive interrupt threshold against a trigger rate that goes up and
+   down by 100x */
+static void
+adaptSweep(int latency)
+{
+  static const double rates[] = { 1e3, 1e4, 1e5, 1e4, 1e3 };
+  int ir, nw, nevts;
+  double t0, dt;
+  c775_intstats st;
+
+  fprintf(out, "\n  adaptive interrupts, %d us latency ceiling\n\n"
+	  "  %10s %12s %9s %9s %9s\n", latency, "trigger Hz", "events/s",
+	  "irq/s", "evTrigger", "flushes");
+
+  c775IntRingInit(RING_SLOTS, rbuf, BLOCK_WORDS);
+  c775IntConnect(NULL, 0, 0, 0);
+  c775IntSetAdaptive(latency);
+  c775IntEnable(0, 1);
+  for (ir = 0; ir < NELEM(rates); ir++)
+    {
+      c775EmuSetRate(rates[ir]);
+      nevts = 0;
+      t0 = now();
+      while ((dt = now() - t0) < 0.5)
+	{
+	  nw = c775IntRingRead((UINT32 *) buf, BLOCK_WORDS, NULL);
+	  if (nw > 0)
+	    nevts++;
+	  else if (nw == 0)
+	    c775IntRingWait(10);
+	}
+      c775IntGetStats(0, &st);
+      fprintf(out, "  %10.0f %12.0f %9u %9d %9u\n", rates[ir], nevts / dt,
+	      (unsigned int) (st.count / dt), st.evTrigger, st.flushes);
+      /* Per step counts */
+      c775IntDisable(1);
+      c775IntEnable(0, st.evTrigger);
+    }
+  c775EmuSetRate(0);
+  c775IntDisable(1);
+  c775IntSetAdaptive(0);
+}
+#endif
+
+/* Bus cycles of one call of each readiness check and readout function,
+   on TDC 0 holding nev events */
+#define COST(name, call) {				\
+    c0 = c775GetBusCycles();				\
+    call;						\
+    fprintf(out, "  %-28s %6u\n", name, c775GetBusCycles() - c0);}
+
+static void
+callCosts(int ntdc, int nev)
+{
+  unsigned int c0;
+
+  fprintf(out, "\n  %-28s %6s\n", "call (TDC 0, 4 events)", "cycles");
+  c775Clear(0);
+  COST("c775Dready, empty", c775Dready(0));
+  COST("c775DreadyFast, empty", c775DreadyFast(0));
+  trigger(nev);
+  COST("c775Dready", c775Dready(0));
+  COST("c775DreadyFast, new events", c775DreadyFast(0));
+  COST("c775DreadyFast, pending", c775DreadyFast(0));
+  COST("c775ReadEvent, pending", c775ReadEvent(0, (UINT32 *) buf));
+  c775DreadyFast(0);
+  COST("c775ReadEvents, pending", c775ReadEvents(0, buf, BLOCK_WORDS,
+						  &evIndex));
+  trigger(nev);
+  COST("c775ReadEvent", c775ReadEvent(0, (UINT32 *) buf));
+  COST("c775ReadEvents", c775ReadEvents(0, buf, BLOCK_WORDS, &evIndex));
+  trigger(nev);
+  COST("c775ReadBlock", c775ReadBlock(0, buf, BLOCK_WORDS));
+  if (ntdc >= 2)
+    {
+      trigger(nev);
+      vmeDmaConfig(2, 3, 0);
+      COST("c775ReadCBLT", c775ReadCBLT(buf, ntdc * BLOCK_WORDS,
+					 &cbltIndex));
+      vmeDmaConfig(1, 3, 0);
+    }
+  fprintf(out, "\n");
+}
+
+/* Bus cycles and time to bring up ntdc TDCs from power on, and to load
+   their thresholds */
+#define COST_MS(name, call) {						\
+    c0 = c775GetBusCycles();						\
+    t0 = now();								\
+    call;								\
+    fprintf(out, "  %-28s %6u %9.3f\n", name, c775GetBusCycles() - c0,	\
+	    (now() - t0) * 1e3);}
+#define STARTUP(name, call) {						\
+    if (c775CBLTAdr != 0)						\
+      c775CBLTDisable();						\
+    COST_MS(name, call);}
+
+static void
+startupCosts(int ntdc)
+{
+  unsigned int c0;
+  double t0;
+  UINT32 last = TDC0_BASE_ADDR + (ntdc - 1) * TDC_BASE_INCR;
+  static UINT16 thr[C775_MAX_BOARDS][C775_MAX_CHANNELS];
+  int id, ch;
+
+#ifdef C775_EMU
+  int ii;
+
+  c775EmuRemoveAll();
+  for (ii = 0; ii < ntdc; ii++)
+    c775EmuAddBoard(TDC0_BASE_ADDR + ii * TDC_BASE_INCR, 2 + ii);
+#endif
+
+  fprintf(out, "  %-28s %6s %9s\n", "crate startup", "cycles", "ms");
+  STARTUP("c775Init",
+	  c775Init(TDC0_BASE_ADDR, TDC_BASE_INCR, ntdc, CRATE_ID));
+  STARTUP("c775Discover",
+	  c775Discover(TDC0_BASE_ADDR, last, TDC_BASE_INCR, CRATE_ID, 0));
+  STARTUP("c775Discover, MCST",
+	  c775Discover(TDC0_BASE_ADDR, last, TDC_BASE_INCR, CRATE_ID,
+		       CBLT_ADDR));
+
+  /* The last Discover left the MCST chain set up */
+  for (id = 0; id < ntdc; id++)
+    for (ch = 0; ch < C775_MAX_CHANNELS; ch++)
+      thr[id][ch] = 0x10 + ch;
+  COST_MS("c775SetThresholdsAll, same", c775SetThresholdsAll(thr));
+  for (id = 0; id < ntdc; id++)
+    for (ch = 0; ch < C775_MAX_CHANNELS; ch++)
+      thr[id][ch] = 0x20 + id + ch;
+  COST_MS("c775SetThresholdsAll, each", c775SetThresholdsAll(thr));
+  COST_MS("c775SetThresholdsAll, again", c775SetThresholdsAll(thr));
+  fprintf(out, "  (%d TDCs)\n\n", ntdc);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nread = 200, maxtdc = 8, onlyMode = -1, latency = 0;
+  int opt, mode, ib, ih, ie, ii, ntdc, devnull, saveout;
+  double *lat;
+  DMA_MEM_ID pool;
+  DMANODE *node[3 + RING_SLOTS];
+
+  while ((opt = getopt(argc, argv, "n:b:m:sl:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  nread = atoi(optarg);
+	  break;
+	case 'b':
+	  maxtdc = atoi(optarg);
+	  break;
+	case 'm':
+	  for (mode = 0; mode < NMODES; mode++)
+	    if (strcmp(optarg, modeName[mode]) == 0)
+	      onlyMode = mode;
+	  break;
+	case 's':
+	  blockSwap = 1;
+	  break;
+	case 'l':
+	  latency = atoi(optarg);
+	  break;
+	default:
+	  printf("usage: %s [-n reads per point] [-b max TDCs] [-m mode] [-s]"
+		 " [-l latency us]\n", argv[0]);
+	  return -1;
+	}
+    }
+  if (nread < 1)
+    nread = 200;
+  if ((maxtdc < 1) || (maxtdc > C775_MAX_BOARDS))
+    maxtdc = 8;
+
+  vmeSetQuietFlag(1);
+  if (vmeOpenDefaultWindows() != OK)
+    return -1;
+
+  c775SetBlockSwap(blockSwap);
+
+#ifdef C775_EMU
+  if (getenv("C775EMU_LATENCY") == NULL)
+    c775EmuSetLatency(EMU_CYCLE_NS, EMU_DMA_SETUP_NS, EMU_DMA_WORD_NS);
+#endif
+
+  pool = dmaPCreate("c775Bench", C775_MAX_BOARDS * BLOCK_WORDS * 4,
+		    3 + RING_SLOTS, 0);
+  if (pool == NULL)
+    {
+      printf("c775Bench: Unable to allocate DMA memory\n");
+      goto CLOSE;
+    }
+  node[0] = dmaPGetItem(pool);
+  node[1] = dmaPGetItem(pool);
+  node[2] = dmaPGetItem(pool);
+  buf = node[0]->data;
+  abuf[0] = node[1]->data;
+  abuf[1] = node[2]->data;
+  for (ii = 0; ii < RING_SLOTS; ii++)
+    {
+      node[3 + ii] = dmaPGetItem(pool);
+      rbuf[ii] = node[3 + ii]->data;
+    }
+  if (c775ReadBlockBufInit(2, abuf, BLOCK_WORDS) != OK)
+    goto CLOSE;
+
+  lat = (double *) malloc(nread * sizeof(double));
+
+  epfd = epoll_create1(0);
+  if (epfd >= 0)
+    {
+      struct epoll_event ev = { EPOLLIN, {0} };
+      epoll_ctl(epfd, EPOLL_CTL_ADD, c775IntEventFd(), &ev);
+    }
+
+  /* Keep the library's messages out of the results */
+  out = fdopen(dup(fileno(stdout)), "w");
+  fflush(stdout);
+  devnull = open("/dev/null", O_WRONLY);
+  saveout = dup(fileno(stdout));
+  dup2(devnull, fileno(stdout));
+
+  fprintf(out, "\n  c775Bench: %d reads per point", nread);
+  if (blockSwap)
+    fprintf(out, ", block swap");
+#ifdef C775_EMU
+  fprintf(out, ", emulated bus");
+#endif
+  fprintf(out, "\n\n  %-7s %5s %5s %6s %12s %9s %9s %9s %9s\n",
+	  "mode", "tdcs", "hits", "ev/rd", "events/s", "MB/s", "cyc/ev",
+	  "p50 us", "p99 us");
+
+  for (ib = 0; ib < NELEM(boardList); ib++)
+    {
+      ntdc = boardList[ib];
+      if (ntdc > maxtdc)
+	break;
+      if (setupCrate(ntdc) != OK)
+	{
+	  fprintf(out, "c775Bench: Unable to initialize %d TDCs\n", ntdc);
+	  break;
+	}
+
+      vmeDmaConfig(1, 3, 0);	/* A24 MBLT */
+      for (mode = 0; mode < NMODES; mode++)
+	{
+	  if ((onlyMode >= 0) && (mode != onlyMode))
+	    continue;
+	  if ((mode == MODE_CBLT) && (ntdc < 2))
+	    continue;
+	  if (mode == MODE_CBLT)
+	    vmeDmaConfig(2, 3, 0);	/* A32 MBLT for the chain */
+	  for (ih = 0; ih < NELEM(hitList); ih++)
+	    for (ie = 0; ie < NELEM(evList); ie++)
+	      runPoint(mode, ntdc, hitList[ih], evList[ie], nread, lat);
+	  if (mode == MODE_CBLT)
+	    vmeDmaConfig(1, 3, 0);
+	}
+    }
+
+  ntdc = (maxtdc >= 2) ? 2 : 1;
+  if (setupCrate(ntdc) == OK)
+    {
+      vmeDmaConfig(1, 3, 0);
+      callCosts(ntdc, 4);
+    }
+  startupCosts(maxtdc);
+#ifdef C775_EMU
+  if ((latency > 0) && (setupCrate(1) == OK))
+    {
+      vmeDmaConfig(1, 3, 0);
+      adaptSweep(latency);
+    }
+#endif
+
+  c775IntEventFdClose();
+  if (epfd >= 0)
+    close(epfd);
+  free(lat);
+  fflush(stdout);
+  dup2(saveout, fileno(stdout));
+  fclose(out);
+
+CLOSE:
+
+  vmeCloseDefaultWindows();
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * File:
+ *    c775DecodeBench.c
+ *
+ * Description:
+ *    Check and time the block scan (c775ScanBlock), hit decode
+ *    (c775DecodeBlock) and byte swap (c775SwapBlock) kernels of libc775
+ *    for every vector instruction set the CPU supports.  Blocks of events from a crate of TDCs are
+ *    made up in memory, in VME (big endian) byte order as the DMA leaves
+ *    them, so no VME access is needed.  Every scan kernel must give the same result as the scalar
+ *    one, on valid blocks and on blocks with one corrupted word.  Every
+ *    decode kernel must give back the hits that went into the block, and
+ *    every swap kernel the block in CPU byte order.
+ *
+ *    usage: c775DecodeBench [ntdc] [hits per TDC] [passes]
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "jvme.h"
+#include "c775Lib.h"
+
+static const char *simdName[] = { "scalar", "sse4", "avx2" };
+
+static UINT32 block[C775_MAX_SCAN_WORDS], hblock[C775_MAX_SCAN_WORDS];
+static UINT32 sblock[C775_MAX_SCAN_WORDS];
+static c775_scan scanRef, scanTst;
+
+/* Hits that went into the block, and decoded hits */
+#define MAXHITS  (C775_MAX_SCAN_WORDS)
+static unsigned char refBoard[MAXHITS], refChan[MAXHITS], refFlags[MAXHITS];
+static unsigned short refValue[MAXHITS];
+static unsigned int refEvent[MAXHITS];
+static int refHits, refEvents;
+static unsigned char hBoard[MAXHITS], hChan[MAXHITS], hFlags[MAXHITS];
+static unsigned short hValue[MAXHITS];
+static unsigned int hEvent[MAXHITS];
+static c775_hits hits = { MAXHITS, 0, 0, 0, hBoard, hChan, hFlags, hValue,
+  hEvent
+};
+
+static double
+now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/* Fill block with C775_MAX_EVENTS events from each of ntdc TDCs, as a
+   CBLT would.  Returns the number of words */
+static int
+makeBlock(int ntdc, int nhits)
+{
+  int id, ev, ii, n = 0, geo, nh, ch, fl, val;
+  UINT32 word;
+
+  refHits = 0;
+  for (id = 0; id < ntdc; id++)
+    {
+      geo = (2 + id) << 27;
+      for (ev = 0; ev < C775_MAX_EVENTS; ev++)
+	{
+	  nh = (nhits > 0) ? (rand() % (2 * nhits + 1)) : 0;
+	  if (nh > C775_MAX_CHANNELS)
+	    nh = C775_MAX_CHANNELS;
+	  word = geo | C775_HEADER_DATA | (nh << 8);
+	  block[n++] = LSWAP(word);
+	  for (ii = 0; ii < nh; ii++)
+	    {
+	      ch = (ii * 7 + ev) % C775_MAX_CHANNELS;
+	      fl = rand() & 7;
+	      val = rand() & 0xfff;
+	      word = geo | C775_DATA | (ch << 16) | (fl << 12) | val;
+	      block[n++] = LSWAP(word);
+	      refBoard[refHits] = 2 + id;
+	      refChan[refHits] = ch;
+	      refFlags[refHits] = fl;
+	      refValue[refHits] = val;
+	      refEvent[refHits] = 1000 * id + ev;
+	      refHits++;
+	    }
+	  word = geo | C775_TRAILER_DATA | (1000 * id + ev);
+	  block[n++] = LSWAP(word);
+	}
+    }
+  /* DMA end of block filler */
+  block[n++] = LSWAP(C775_INVALID_DATA);
+  block[n++] = LSWAP(C775_INVALID_DATA);
+  refEvents = ntdc * C775_MAX_EVENTS;
+
+  /* Same block, in CPU byte order */
+  for (ii = 0; ii < n; ii++)
+    hblock[ii] = LSWAP(block[ii]);
+
+  return n;
+}
+
+static int
+sameScan(c775_scan * a, c775_scan * b)
+{
+  if ((a->nevents != b->nevents) || (a->nwords != b->nwords) ||
+      (a->error != b->error) || (a->errOffset != b->errOffset))
+    return 0;
+  if (memcmp(a->offset, b->offset, (a->nevents + 1) * sizeof(int)))
+    return 0;
+  if (memcmp(a->geo, b->geo, a->nevents))
+    return 0;
+  return 1;
+}
+
+static int
+sameHits()
+{
+  int ii;
+
+  if ((hits.nhits != refHits) || (hits.nevents != refEvents))
+    return 0;
+  for (ii = 0; ii < refHits; ii++)
+    {
+      if ((hBoard[ii] != refBoard[ii]) || (hChan[ii] != refChan[ii]) ||
+	  (hFlags[ii] != refFlags[ii]) || (hValue[ii] != refValue[ii]) ||
+	  (hEvent[ii] != refEvent[ii]))
+	return 0;
+    }
+  return 1;
+}
+
+static double
+rate(int nwrds, int npass, double dt)
+{
+  return 1e-6 * nwrds * npass / dt;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ntdc = 8, nhits = 8, npass = 2000;
+  int nwrds, level, best, ok, pos, fail = 0;
+  UINT32 save;
+  double t0, dt;
+
+  if (argc > 1)
+    ntdc = atoi(argv[1]);
+  if (argc > 2)
+    nhits = atoi(argv[2]);
+  if (argc > 3)
+    npass = atoi(argv[3]);
+  if ((ntdc < 1) || (ntdc > C775_MAX_BOARDS))
+    ntdc = 8;
+
+  srand(775);
+  nwrds = makeBlock(ntdc, nhits);
+  best = c775SetSimd(C775_SIMD_AUTO);
+
+  printf("\n  c775DecodeBench: %d TDCs x %d events, %d words, %d hits, "
+	 "%d passes\n\n", ntdc, C775_MAX_EVENTS, nwrds, refHits, npass);
+
+  /* Scalar reference: valid block */
+  c775SetSimd(C775_SIMD_SCALAR);
+  if (c775ScanBlock(block, nwrds, 1, &scanRef) != refEvents)
+    {
+      printf("  scan: valid block rejected (error %d at word %d)\n",
+	     scanRef.error, scanRef.errOffset);
+      fail++;
+    }
+
+  printf("  %-8s %8s %14s %14s %8s\n", "kernel", "", "Mwords/s",
+	 "Mwords/s swap", "check");
+  for (level = C775_SIMD_SCALAR; level <= best; level++)
+    {
+      /* Scan: same index as the scalar scan, on the valid block and with
+         each of a set of corrupted words */
+      c775SetSimd(level);
+      c775ScanBlock(block, nwrds, 1, &scanTst);
+      ok = sameScan(&scanRef, &scanTst);
+      for (pos = 1; ok && (pos < nwrds); pos += 97)
+	{
+	  save = block[pos];
+	  block[pos] ^= LSWAP((UINT32) (1 << (24 + (pos % 8))));
+	  c775SetSimd(C775_SIMD_SCALAR);
+	  c775ScanBlock(block, nwrds, 1, &scanRef);
+	  c775SetSimd(level);
+	  c775ScanBlock(block, nwrds, 1, &scanTst);
+	  ok = sameScan(&scanRef, &scanTst) && (scanTst.error != C775_SCAN_OK);
+	  block[pos] = save;
+	}
+      c775SetSimd(C775_SIMD_SCALAR);
+      c775ScanBlock(block, nwrds, 1, &scanRef);
+      c775SetSimd(level);
+      fail += !ok;
+
+      printf("  %-8s %8s", simdName[level], "scan");
+      t0 = now();
+      for (pos = 0; pos < npass; pos++)
+	c775ScanBlock(hblock, nwrds, 0, &scanTst);
+      printf(" %14.1f", rate(nwrds, npass, now() - t0));
+      t0 = now();
+      for (pos = 0; pos < npass; pos++)
+	c775ScanBlock(block, nwrds, 1, &scanTst);
+      printf(" %14.1f %8s\n", rate(nwrds, npass, now() - t0),
+	     ok ? "ok" : "FAILED");
+
+      /* Decode: the hits that went into the block, either byte order */
+      c775DecodeBlock(block, nwrds, 1, &hits);
+      ok = sameHits();
+      memset(hValue, 0, sizeof(hValue));
+      c775DecodeBlock(hblock, nwrds, 0, &hits);
+      ok = ok && sameHits();
+      fail += !ok;
+
+      printf("  %-8s %8s", "", "decode");
+      t0 = now();
+      for (pos = 0; pos < npass; pos++)
+	c775DecodeBlock(hblock, nwrds, 0, &hits);
+      printf(" %14.1f", rate(nwrds, npass, now() - t0));
+      t0 = now();
+      for (pos = 0; pos < npass; pos++)
+	c775DecodeBlock(block, nwrds, 1, &hits);
+      dt = now() - t0;
+      printf(" %14.1f %8s\n", rate(nwrds, npass, dt), ok ? "ok" : "FAILED");
+
+      /* Swap: VME to CPU byte order, in place, at any alignment */
+      ok = 1;
+      for (pos = 0; pos < 3; pos++)
+	{
+	  memcpy(sblock, block, nwrds * sizeof(UINT32));
+	  c775SwapBlock(&sblock[pos], nwrds - pos);
+	  ok = ok && !memcmp(&sblock[pos], &hblock[pos],
+			     (nwrds - pos) * sizeof(UINT32));
+	}
+      fail += !ok;
+
+      printf("  %-8s %8s %14s", "", "swap", "");
+      t0 = now();
+      for (pos = 0; pos < npass; pos++)
+	c775SwapBlock(sblock, nwrds);
+      dt = now() - t0;
+      printf(" %14.1f %8s\n", rate(nwrds, npass, dt), ok ? "ok" : "FAILED");
+    }
+  printf("\n");
+
+  return fail ? -1 : 0;
+}
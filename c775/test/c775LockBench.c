@@ -0,0 +1,205 @@
+/*
+ * File:
+ *    c775LockBench.c
+ *
+ * Description:
+ *    Lock contention benchmark for libc775.  One readout thread per TDC
+ *    polls c775Dready() on its own board; the number of threads is swept
+ *    from 1 to the number of TDCs.  Each sweep is run with the per board
+ *    locks, with the locks plus a monitoring thread calling c775Status()
+ *    on TDC 0, in single owner (lock free) mode, and with every thread
+ *    owning its TDC through a library context of its own (c775CtxCreate).
+ *
+ *    usage: c775LockBench [ntdc] [msec per point]
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include "jvme.h"
+#include "c775Lib.h"
+
+#define TDC0_BASE_ADDR         0x00440000
+#define TDC_BASE_INCR          0x010000
+#define CRATE_ID               0
+
+#define MODE_LOCKED   0
+#define MODE_MONITOR  1
+#define MODE_SINGLE   2
+#define MODE_CTX      3
+
+static const char *modeName[] = { "locked", "locked+status", "single owner",
+  "own context"
+};
+
+static volatile int running = 0;
+static long long ops[C775_MAX_BOARDS];
+static c775_ctx *ctx[C775_MAX_BOARDS];
+
+static void *
+reader(void *arg)
+{
+  int id = (int) (long) arg;
+  long long n = 0;
+
+  while (!running)
+    ;
+  while (running)
+    {
+      c775Dready(id);
+      n++;
+    }
+  ops[id] = n;
+  return NULL;
+}
+
+static void *
+ctxReader(void *arg)
+{
+  int id = (int) (long) arg;
+  long long n = 0;
+
+  while (!running)
+    ;
+  while (running)
+    {
+      c775CtxDready(ctx[id], 0);
+      n++;
+    }
+  ops[id] = n;
+  return NULL;
+}
+
+static void *
+monitor(void *arg)
+{
+  while (!running)
+    ;
+  while (running)
+    c775Status(0);
+  return NULL;
+}
+
+static double
+now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ntdc = 4, msec = 500;
+  int mode, nthr, ii, devnull, saveout;
+  pthread_t thr[C775_MAX_BOARDS], mon;
+  double t0, dt, total, base = 0;
+  FILE *out;
+
+  if (argc > 1)
+    ntdc = atoi(argv[1]);
+  if (argc > 2)
+    msec = atoi(argv[2]);
+  if ((ntdc < 1) || (ntdc > C775_MAX_BOARDS))
+    ntdc = 4;
+
+  vmeSetQuietFlag(1);
+  if (vmeOpenDefaultWindows() != OK)
+    return -1;
+
+  if (c775Init(TDC0_BASE_ADDR, TDC_BASE_INCR, ntdc, CRATE_ID) == ERROR)
+    {
+      printf("c775LockBench: Initializing error\n");
+      goto CLOSE;
+    }
+
+  /* Keep c775Status() output out of the results */
+  out = fdopen(dup(fileno(stdout)), "w");
+  fflush(stdout);
+  devnull = open("/dev/null", O_WRONLY);
+  saveout = dup(fileno(stdout));
+  dup2(devnull, fileno(stdout));
+
+  fprintf(out, "\n  c775LockBench: %d TDCs, %d ms per point\n\n", ntdc, msec);
+  fprintf(out, "  %-14s %8s %14s %14s %9s\n",
+	  "mode", "threads", "calls/s", "calls/s/thr", "scaling");
+
+  /* One context per thread, each holding one of the TDCs */
+  for (ii = 0; ii < ntdc; ii++)
+    {
+      ctx[ii] = c775CtxCreate(1);
+      if ((ctx[ii] == NULL)
+	  || (c775CtxInit(ctx[ii], TDC0_BASE_ADDR + ii * TDC_BASE_INCR, 0, 1,
+			  CRATE_ID) == ERROR))
+	{
+	  fprintf(out, "c775LockBench: Context %d initializing error\n", ii);
+	  goto DONE;
+	}
+    }
+
+  for (mode = MODE_LOCKED; mode <= MODE_CTX; mode++)
+    {
+      for (ii = 0; ii < ntdc; ii++)
+	c775SetSingleOwner(ii, mode == MODE_SINGLE);
+
+      for (nthr = 1; nthr <= ntdc; nthr++)
+	{
+	  running = 0;
+	  memset(ops, 0, sizeof(ops));
+	  for (ii = 0; ii < nthr; ii++)
+	    pthread_create(&thr[ii], NULL,
+			   (mode == MODE_CTX) ? ctxReader : reader,
+			   (void *) (long) ii);
+	  if (mode == MODE_MONITOR)
+	    pthread_create(&mon, NULL, monitor, NULL);
+
+	  t0 = now();
+	  running = 1;
+	  usleep(msec * 1000);
+	  running = 0;
+	  dt = now() - t0;
+
+	  for (ii = 0; ii < nthr; ii++)
+	    pthread_join(thr[ii], NULL);
+	  if (mode == MODE_MONITOR)
+	    pthread_join(mon, NULL);
+
+	  total = 0;
+	  for (ii = 0; ii < nthr; ii++)
+	    total += ops[ii];
+	  total /= dt;
+	  if (nthr == 1)
+	    base = total;
+
+	  fprintf(out, "  %-14s %8d %14.0f %14.0f %8.2fx\n",
+		  modeName[mode], nthr, total, total / nthr, total / base);
+	  fflush(out);
+	}
+    }
+
+  for (ii = 0; ii < ntdc; ii++)
+    c775SetSingleOwner(ii, 0);
+
+DONE:
+  for (ii = 0; ii < ntdc; ii++)
+    {
+      if (ctx[ii] != NULL)
+	c775CtxDestroy(ctx[ii]);
+    }
+
+  fflush(stdout);
+  dup2(saveout, fileno(stdout));
+  fclose(out);
+
+CLOSE:
+
+  vmeCloseDefaultWindows();
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * File:
+ *    GEN_source.h
+ *
+ * Description:
+ *    Stand-in for the CODA ROC's GEN_source.h (generic polled trigger
+ *    source), for building a readout list into rolHarness.  CTRIGRSS
+ *    hands the list's trigger and done routines to the harness, which
+ *    calls them itself; the sis3610 trigger module is replaced by
+ *    counters in the harness.
+ *
+ */
+#ifndef __GEN_SOURCE_STANDIN__
+#define __GEN_SOURCE_STANDIN__
+
+typedef void (*GENTRIGFUNC) (unsigned long, unsigned long);
+typedef void (*GENDONEFUNC) (void);
+
+extern int GENPollValue;
+extern GENTRIGFUNC genTrigRtn;
+extern GENDONEFUNC genDoneRtn;
+extern int genEnabled;
+
+/* The list's routines */
+void usrtrig(unsigned long EVTYPE, unsigned long EVSOURCE);
+void usrtrig_done(void);
+
+#define GEN_INIT
+#define CTRIGRSS(source, code, rtn, done) {		\
+    genTrigRtn = (rtn);					\
+    genDoneRtn = (done);				\
+  }
+#define CRTTYPE(type, source, code)
+#define CDOENABLE(source, code, val)   genEnabled = 1
+#define CDODISABLE(source, code, val)  genEnabled = 0
+
+/* sis3610 I/O register, as used for the trigger */
+#define S3610_INIT_DAQ_MODE_POLLING    0
+
+int  s3610Init(unsigned int addr, unsigned int incr, int n, int mode);
+void s3610Status(int id, int pflag);
+void s3610IntAck(int input);
+
+#endif /* __GEN_SOURCE_STANDIN__ */
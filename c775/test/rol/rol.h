@@ -0,0 +1,61 @@
+/*
+ * File:
+ *    rol.h
+ *
+ * Description:
+ *    Stand-in for the CODA ROC's rol.h, for building a readout list into
+ *    rolHarness instead of a ROC.  Only what the lists in this package use
+ *    is provided: the rol parameter block, the event and bank macros
+ *    (with CODA bank headers, lengths filled in on close) and the logging.
+ *
+ */
+#ifndef __ROL_STANDIN__
+#define __ROL_STANDIN__
+
+#include <stdio.h>
+#include "jvme.h"
+
+typedef struct rolParameters
+{
+  int poll;			/* Polled (1) or interrupt (0) triggers */
+  int *async_roc;		/* Non zero: no event building */
+  int *nevents;			/* Triggers read since Prestart */
+  int recNb;			/* Record number */
+  volatile unsigned int *dabufp;	/* Next free word of the event */
+} ROLPARAMS;
+
+extern ROLPARAMS *rol;
+extern int __the_event__;
+extern int poolEmpty;
+extern volatile unsigned int *StartOfEvent, *StartOfBank;
+
+void daLogMsg(char *severity, char *fmt, ...);
+void InsertDummyTriggerBank(int type, int num, int evtype, int nev);
+
+#define ROCID    1
+#define BT_BANK  0x10
+#define BT_UI4   0x01
+
+#define CTRIGINIT
+#define WRITE_EVENT_
+
+/* Event: length, then tag(16)/type(8)/num(8); the length is set on close */
+#define CEOPEN(bnum, btype, nev) {					\
+    StartOfEvent = rol->dabufp;						\
+    *rol->dabufp++ = 0;							\
+    *rol->dabufp++ = ((bnum) << 16) | ((btype) << 8) | ((nev) & 0xff);	\
+  }
+#define CECLOSE								\
+  *StartOfEvent = (unsigned int) (rol->dabufp - StartOfEvent - 1)
+
+#define CBOPEN(bnum, btype, nev) {					\
+    StartOfBank = rol->dabufp;						\
+    *rol->dabufp++ = 0;							\
+    *rol->dabufp++ = ((bnum) << 16) | ((btype) << 8) | ((nev) & 0xff);	\
+  }
+#define CBCLOSE								\
+  *StartOfBank = (unsigned int) (rol->dabufp - StartOfBank - 1)
+
+#define CBWRITE32(x)  *rol->dabufp++ = (x)
+
+#endif /* __ROL_STANDIN__ */
@@ -0,0 +1,349 @@
+/*
+ * File:
+ *    rolHarness.c
+ *
+ * Description:
+ *    Runs a readout list outside of CODA, for profiling its trigger
+ *    handling on a host (e.g. with perf record).  The list's source is
+ *    compiled in (ROL_SOURCE, default ../../gen_list.c) against the
+ *    stand-in rol.h and GEN_source.h in ./rol, so that its static
+ *    routines can be called directly:
+ *
+ *       __download, __prestart, __go,
+ *       usrtrig, usrtrig_done and __done for every trigger,
+ *       __end
+ *
+ *    Built with EMU=1 the TDCs are emulated (../emu) and the harness
+ *    makes their gates, as the trigger latch: one gate, then the next
+ *    one as soon as the list releases the latch (s3610IntAck).  With -B
+ *    it acts as trigger logic that holds off after a block by itself
+ *    instead: block level gates before every trigger, whatever the
+ *    list releases (for C775_TRIGGER_ACK=block).  With C775EMU_RATE
+ *    the emulator times the gates itself.  The event buffer is DMA
+ *    memory, as in the ROC, so the list's zero-copy readout is used;
+ *    with -c it is ordinary memory and the list copies.
+ *
+ *    For every trigger the CPU time of usrtrig, usrtrig_done and __done
+ *    is measured, and at the end the mean, median, 99th percentile and
+ *    maximum are listed, with the wall clock rate, the size of the
+ *    events, the VME cycles (emulator) and trigger acknowledgements per
+ *    trigger.  Every event is checked: each TDC must have exactly the
+ *    block's events in it, with the same event numbers as the others;
+ *    the blocks dropped by the list (empty events) and the bad ones are
+ *    counted.
+ *
+ *    The list reads its own settings from the environment as usual
+ *    (C775_BLOCKLEVEL, C775_CONFIG, C775_LOADGEN...), and the emulator
+ *    its own (C775EMU_LATENCY, C775EMU_HITS...).
+ *
+ *    usage: rolHarness [-n triggers] [-b TDCs] [-l block level] [-B] [-c]
+ *                      [-q]
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <time.h>
+#include "jvme.h"
+#include "c775Lib.h"
+#ifdef C775_EMU
+#include "c775Emu.h"
+#endif
+
+#ifndef DAYTIME
+#define DAYTIME __DATE__ " " __TIME__
+#endif
+#ifndef ROL_SOURCE
+#define ROL_SOURCE "../../gen_list.c"
+#endif
+
+#include ROL_SOURCE
+
+#define TDC0_BASE_ADDR         0x00440000
+#define TDC_BASE_INCR          0x010000
+
+/* What the ROC provides to the list */
+static int asyncRoc, nEvents;
+static ROLPARAMS rolParams = { 0, &asyncRoc, &nEvents, 0, NULL };
+ROLPARAMS *rol = &rolParams;
+int __the_event__ = 0;
+int poolEmpty = 0;
+int bigendian_out = 0;
+volatile unsigned int *StartOfEvent, *StartOfBank;
+
+int GENPollValue = 0;
+GENTRIGFUNC genTrigRtn = NULL;
+GENDONEFUNC genDoneRtn = NULL;
+int genEnabled = 0;
+
+#define GATE_LATCH   0		/* One gate per release */
+#define GATE_BLOCK   1		/* A block of gates per trigger */
+#define GATE_SELF    2		/* Emulator self-timed */
+static int quiet = 0, gateMode = GATE_LATCH;
+static unsigned long long nAck = 0;
+
+void
+daLogMsg(char *severity, char *fmt, ...)
+{
+  va_list args;
+
+  if (quiet && (strcmp(severity, "INFO") == 0))
+    return;
+  printf("%s: ", severity);
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  printf("\n");
+}
+
+/* Trigger bank: the event number and type of each event of the block */
+void
+InsertDummyTriggerBank(int type, int num, int evtype, int nev)
+{
+  int ii;
+
+  *rol->dabufp++ = 2 * nev + 1;
+  *rol->dabufp++ = (type << 16) | (0x20 << 8) | (nev & 0xff);
+  for (ii = 0; ii < nev; ii++)
+    {
+      *rol->dabufp++ = num + ii;
+      *rol->dabufp++ = evtype;
+    }
+}
+
+/* sis3610: every poll is a trigger, releases are counted (and let the
+   next gate through the latch) */
+int
+s3610Init(unsigned int addr, unsigned int incr, int n, int mode)
+{
+  return 1;
+}
+
+void
+s3610Status(int id, int pflag)
+{
+}
+
+void
+s3610IntAck(int input)
+{
+  nAck++;
+#ifdef C775_EMU
+  if (gateMode == GATE_LATCH)
+    c775EmuTrigger(1);
+#endif
+}
+
+/* 0 for a good block, 1 for a dropped one (no events), ERROR if the
+   TDCs do not have nev events each with the same event numbers */
+static int
+checkEvent(volatile unsigned int *ev)
+{
+  volatile unsigned int *bank, *end;
+  unsigned int w, count[32], first[32], last[32];
+  int nev = ev[1] & 0xff, geo, ii, ntdc = 0;
+
+  if (nev == 0)
+    return 1;
+  bank = ev + 2 + ev[2] + 1;	/* Data bank, after the trigger bank */
+  end = bank + bank[0] + 1;
+  memset(count, 0, sizeof(count));
+  for (bank += 3; bank < end - 1; bank++)	/* Inside the markers */
+    {
+      w = *bank;
+      geo = w >> 27;
+      if ((w & C775_DATA_ID_MASK) == C775_TRAILER_DATA)
+	{
+	  if (count[geo] == 0)
+	    first[geo] = w & C775_EVENTCOUNT_MASK;
+	  last[geo] = w & C775_EVENTCOUNT_MASK;
+	  count[geo]++;
+	}
+    }
+  for (geo = 0; geo < 32; geo++)
+    {
+      if (count[geo] == 0)
+	continue;
+      if (count[geo] != nev)
+	return ERROR;
+      for (ii = 0; (ii < 32) && (count[ii] == 0); ii++)
+	;
+      if ((first[geo] != first[ii]) || (last[geo] != last[ii]))
+	return ERROR;
+      ntdc++;
+    }
+  return (ntdc > 0) ? 0 : ERROR;
+}
+
+static double
+cpuNow()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static double
+now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static int
+cmpDouble(const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int opt, ii, ntrig = 10000, nboards = 4, copy = 0;
+  char level[16];
+  double *cpu, t0, t1, sum = 0.0;
+  unsigned long long words = 0, cycles = 0;
+  int ndropped = 0, nbad = 0, rval;
+  volatile unsigned int *evbuf;
+  DMA_MEM_ID evPart = NULL;
+  DMANODE *evNode;
+
+  while ((opt = getopt(argc, argv, "n:b:l:Bcq")) != -1)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  ntrig = atoi(optarg);
+	  break;
+	case 'b':
+	  nboards = atoi(optarg);
+	  break;
+	case 'l':
+	  snprintf(level, sizeof(level), "%d", atoi(optarg));
+	  setenv("C775_BLOCKLEVEL", level, 1);
+	  break;
+	case 'B':
+	  gateMode = GATE_BLOCK;
+	  break;
+	case 'c':
+	  copy = 1;
+	  break;
+	case 'q':
+	  quiet = 1;
+	  break;
+	default:
+	  printf("usage: %s [-n triggers] [-b TDCs] [-l block level] [-B] [-c]"
+		 " [-q]\n", argv[0]);
+	  return 1;
+	}
+    }
+  if ((ntrig < 1) || ((cpu = malloc(ntrig * sizeof(double))) == NULL))
+    return 1;
+
+#ifdef C775_EMU
+  for (ii = 0; ii < nboards; ii++)
+    c775EmuAddBoard(TDC0_BASE_ADDR + ii * TDC_BASE_INCR, 2 + ii);
+  if (getenv("C775EMU_RATE") != NULL)
+    gateMode = GATE_SELF;
+#endif
+
+  __download();
+
+  /* The event buffer, after Download: the list frees all DMA memory */
+  if (copy)
+    evbuf = malloc(MAX_EVENT_LENGTH);
+  else
+    {
+      evPart = dmaPCreate("rolEvents", MAX_EVENT_LENGTH, 1, 0);
+      dmaPReInitAll();
+      evNode = dmaPGetItem(evPart);
+      evbuf = (evNode != NULL) ? evNode->data : NULL;
+    }
+  if (evbuf == NULL)
+    {
+      printf("%s: no event buffer\n", argv[0]);
+      return 1;
+    }
+
+  __prestart();
+  if (genTrigRtn == NULL)
+    {
+      printf("%s: the list did not set up a trigger source\n", argv[0]);
+      return 1;
+    }
+  __go();
+
+#ifdef C775_EMU
+  c775EmuResetStats();
+#endif
+  nAck = 0;
+#ifdef C775_EMU
+  if (gateMode == GATE_LATCH)
+    c775EmuTrigger(1);		/* The first trigger, held by the latch */
+#endif
+  t0 = now();
+  for (ii = 0; (ii < ntrig) && genEnabled; ii++)
+    {
+#ifdef C775_EMU
+      if (gateMode == GATE_BLOCK)
+	c775EmuTrigger(blklevel);
+#endif
+      rol->dabufp = evbuf;
+
+      cpu[ii] = cpuNow();
+      (*genTrigRtn) (1, 1);
+      (*genDoneRtn) ();
+      __done();
+      cpu[ii] = cpuNow() - cpu[ii];
+
+      (*rol->nevents)++;
+      words += rol->dabufp - evbuf;
+      if ((rol->dabufp - evbuf) * 4 > MAX_EVENT_LENGTH)
+	{
+	  printf("%s: trigger %d overran the event buffer (%ld words)\n",
+		 argv[0], ii, (long) (rol->dabufp - evbuf));
+	  return 1;
+	}
+      rval = checkEvent(evbuf);
+      if (rval == 1)
+	ndropped++;
+      else if (rval == ERROR)
+	nbad++;
+    }
+  t1 = now();
+  ntrig = ii;
+#ifdef C775_EMU
+  cycles = c775EmuCycles();
+#endif
+
+  __end();
+
+  for (ii = 0; ii < ntrig; ii++)
+    sum += cpu[ii];
+  qsort(cpu, ntrig, sizeof(double), cmpDouble);
+
+  printf("\n%d triggers of %d event(s), %d TDC(s), %s event buffer\n",
+	 ntrig, blklevel, Nc775, copy ? "copied into the" : "DMA into the");
+  printf("  gates: %s, trigger released per %s\n",
+	 (gateMode == GATE_LATCH) ? "latch" :
+	 (gateMode == GATE_BLOCK) ? "block hold off" : "self-timed",
+	 ackPerEvent ? "event" : "block");
+  printf("  CPU us/trigger:  mean %.2f  p50 %.2f  p99 %.2f  max %.2f\n",
+	 1e6 * sum / ntrig, 1e6 * cpu[ntrig / 2],
+	 1e6 * cpu[(int) (0.99 * (ntrig - 1))], 1e6 * cpu[ntrig - 1]);
+  printf("  %.0f triggers/s (wall), %.1f words/trigger, "
+	 "%.1f VME cycles/trigger, %.2f acks/trigger\n",
+	 ntrig / (t1 - t0), (double) words / ntrig, (double) cycles / ntrig,
+	 (double) nAck / ntrig);
+  printf("  %d block(s) dropped, %d bad\n", ndropped, nbad);
+
+  if (copy)
+    free((void *) evbuf);
+  free(cpu);
+  return 0;
+}
@@ -1,5 +1,6 @@
 #define ROL_NAME__ "GEN_USER"
-#define MAX_EVENT_LENGTH 32768
+/* A block of events from a full crate of c775 TDCs */
+#define MAX_EVENT_LENGTH (1024*128)
 #define MAX_EVENT_POOL   100
 /* POLLING_MODE */
 #define POLLING___
@@ -8,13 +9,403 @@
 #define INIT_NAME gen_list__init
 #include <rol.h>
 #include <GEN_source.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include "c775Lib.h"
 #define TRIG_ADDR 0x3800
 #define TRIG_INPUT 1
 #define DAQ_MODE S3610_INIT_DAQ_MODE_POLLING
+/* c775 TDCs: every slot from C775_ADDR to C775_ADDR_END is probed */
+#define C775_ADDR      0x00440000
+#define C775_ADDR_END  0x00530000
+#define C775_ADDR_INC  0x00010000
+#define C775_MCST_ADDR 0xAA000000
+#define C775_CONFIG    "c775.cfg"	/* or $C775_CONFIG */
+#define C775_BUF_WORDS (C775_MAX_BLOCK_WORDS + 2)	/* Full buffer + BERR */
+/* Longest wait for the rest of a block, and how the TDCs are polled
+   meanwhile: back to back for BLOCK_SPIN_NS after each new event, then
+   every BLOCK_POLL_NS (ns) */
+#define BLOCK_TIMEOUT_NS  1000000000ULL
+#define BLOCK_SPIN_NS     20000ULL
+#define BLOCK_POLL_NS     50000
 extern int bigendian_out;
-int blklevel = 1;
-int ndatawords = 10;
+extern int Nc775;
+int blklevel = 1;		/* Events per block, or $C775_BLOCKLEVEL */
+/* Trigger release ($C775_TRIGGER_ACK): once per event, as the latch is
+   the only hold off; or once per block, by __done ("block"), only when
+   the trigger logic holds off after a block of triggers by itself */
+static int ackPerEvent = 1;
 int trigBankType = 0xff11;
+static c775_config c775Cfg;
+static c775_evindex c775Index;
+static DMA_MEM_ID vmeIN;
+static DMANODE *c775Node;
+/* Events read from a TDC beyond the block, for the next block */
+static unsigned int c775Carry[C775_MAX_BOARDS][C775_MAX_BLOCK_WORDS];
+static int c775CarryEv[C775_MAX_BOARDS], c775CarryWords[C775_MAX_BOARDS];
+
+/* Run statistics, reported at End */
+static struct timespec runStart;
+static unsigned long long runEvents, runWords;
+
+/* Load generator: with $C775_LOADGEN set, the TDCs are not read and each
+   trigger carries blklevel made up c775 events for each of lgTdcs TDCs.
+
+     C775_LOADGEN          = "rate[,tdcs]"  event rate in Hz, i.e. a
+                                            trigger every blklevel/rate s
+                                            (0: as fast as triggers
+                                            come), TDCs (1)
+     C775_LOADGEN_HITS     = "nhits[,poisson]"  hits per TDC per event (8),
+                                            fixed or Poisson distributed
+     C775_LOADGEN_HIST     = file of weights, one per line, for 0, 1, 2 ...
+                             hits (a histogram recorded from real data)
+     C775_LOADGEN_CHANNELS = mask of the channels that can have hits
+
+   The hits of an event go to distinct channels of the mask, so the mask
+   and the number of hits set the channel occupancy.  The list times its
+   own triggers: usrtrig waits for the next one is due, so the trigger
+   input only needs to be faster than the rate (or held active). */
+static int lgOn = 0, lgTdcs = 1, lgHits = 8, lgPoisson = 0;
+static double lgRate = 0.0, lgExpHits;
+static double lgHist[C775_MAX_CHANNELS + 1];
+static int lgHistN = 0;
+static unsigned int lgChannels = 0xffffffff, lgSeed = 0x775, lgEvCount;
+static unsigned long long lgNext;	/* Trigger due (ns since Go) */
+#define LG_SPIN_NS  5000ULL
+
+static unsigned long long
+nsSince(struct timespec *t0)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - t0->tv_sec) * 1000000000ULL + t.tv_nsec - t0->tv_nsec;
+}
+
+static unsigned int
+lgRand()
+{
+  lgSeed ^= lgSeed << 13;
+  lgSeed ^= lgSeed >> 17;
+  lgSeed ^= lgSeed << 5;
+  return lgSeed;
+}
+
+static double
+lgUniform()
+{
+  return (lgRand() >> 8) / 16777216.0;
+}
+
+/* Hits in one TDC for one event */
+static int
+lgNHits()
+{
+  int n = lgHits, nmax = __builtin_popcount(lgChannels);
+  double u, p;
+
+  if (lgHistN > 0)
+    {
+      u = lgUniform();
+      for (n = 0; n < lgHistN - 1; n++)
+	{
+	  if (u < lgHist[n])
+	    break;
+	  u -= lgHist[n];
+	}
+    }
+  else if (lgPoisson)
+    {
+      p = 1.0;
+      n = -1;
+      do
+	{
+	  n++;
+	  p *= lgUniform();
+	}
+      while ((p > lgExpHits) && (n < nmax));
+    }
+
+  return (n > nmax) ? nmax : n;
+}
+
+static void
+lgInit()
+{
+  char *env, *end, line[64];
+  FILE *fp;
+  double sum = 0.0, rate = 0.0;
+  int ii, n, len, tdcs = 1, hits = 8, poisson = 0;
+  unsigned long mask;
+
+  lgOn = 0;
+  lgRate = 0.0;
+  lgTdcs = 1;
+  lgHits = 8;
+  lgPoisson = 0;
+  lgChannels = 0xffffffff;
+  if ((env = getenv("C775_LOADGEN")) == NULL)
+    return;
+  lgOn = 1;
+
+  /* A bad setting is reported and left at its default */
+  len = 0;
+  n = sscanf(env, "%lf%n,%d%n", &rate, &len, &tdcs, &len);
+  if ((n < 1) || (env[len] != '\0') || (rate < 0.0) || (tdcs < 1) || (tdcs > C775_MAX_BOARDS))
+    daLogMsg("ERROR", "C775_LOADGEN \"%s\": want rate (>= 0) and TDCs"
+	     " (1-%d), using %g,%d", env, C775_MAX_BOARDS, lgRate, lgTdcs);
+  else
+    {
+      lgRate = rate;
+      lgTdcs = tdcs;
+    }
+  if ((env = getenv("C775_LOADGEN_HITS")) != NULL)
+    {
+      len = 0;
+      n = sscanf(env, "%d%n,%d%n", &hits, &len, &poisson, &len);
+      if ((n < 1) || (env[len] != '\0') || (hits < 0) || (hits > C775_MAX_CHANNELS))
+	daLogMsg("ERROR", "C775_LOADGEN_HITS \"%s\": want hits (0-%d),"
+		 " using %d", env, C775_MAX_CHANNELS, lgHits);
+      else
+	{
+	  lgHits = hits;
+	  lgPoisson = poisson;
+	}
+    }
+  if ((env = getenv("C775_LOADGEN_CHANNELS")) != NULL)
+    {
+      mask = strtoul(env, &end, 0);
+      if ((end == env) || (*end != '\0') || (mask > 0xffffffffUL))
+	daLogMsg("ERROR", "C775_LOADGEN_CHANNELS \"%s\": want a channel"
+		 " mask, using 0x%x", env, lgChannels);
+      else
+	lgChannels = mask;
+    }
+  lgExpHits = exp(-(double) lgHits);
+
+  lgHistN = 0;
+  if (((env = getenv("C775_LOADGEN_HIST")) != NULL)
+      && ((fp = fopen(env, "r")) == NULL))
+    daLogMsg("ERROR", "C775_LOADGEN_HIST: cannot open %s", env);
+  else if (env != NULL)
+    {
+      while ((lgHistN <= C775_MAX_CHANNELS)
+	     && (fgets(line, sizeof(line), fp) != NULL))
+	{
+	  if (sscanf(line, "%lf", &lgHist[lgHistN]) == 1)
+	    sum += lgHist[lgHistN++];
+	}
+      fclose(fp);
+      if (sum > 0.0)
+	for (ii = 0; ii < lgHistN; ii++)
+	  lgHist[ii] /= sum;
+      else
+	{
+	  daLogMsg("ERROR", "C775_LOADGEN_HIST: no weights in %s", env);
+	  lgHistN = 0;
+	}
+    }
+
+  daLogMsg("INFO", "Load generator: %g events/s, %d TDC(s), %d hits%s%s",
+	   lgRate, lgTdcs, lgHits, lgPoisson ? " (Poisson)" : "",
+	   lgHistN ? " (histogram)" : "");
+}
+
+/* Wait until the next trigger is due: asleep, but for the last
+   LG_SPIN_NS, which are spun to be on time despite the wake up latency */
+static void
+lgWaitTrigger()
+{
+  struct timespec due;
+  unsigned long long ns;
+
+  if (lgRate <= 0.0)
+    return;
+  if (lgNext > nsSince(&runStart) + LG_SPIN_NS)
+    {
+      ns = runStart.tv_nsec + lgNext - LG_SPIN_NS;
+      due.tv_sec = runStart.tv_sec + ns / 1000000000ULL;
+      due.tv_nsec = ns % 1000000000ULL;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL)
+	     == EINTR)
+	;
+    }
+  while (nsSince(&runStart) < lgNext)
+    ;
+  lgNext += (unsigned long long) (1e9 * blklevel / lgRate);
+}
+
+/* blklevel events for each TDC, in the c775 data format */
+static void
+lgWriteBlock()
+{
+  int id, iev, ii, nhits;
+  unsigned int geo, chmask, ch;
+
+  for (id = 0; id < lgTdcs; id++)
+    {
+      geo = (unsigned int) (id + 2) << 27;
+      for (iev = 0; iev < blklevel; iev++)
+	{
+	  nhits = lgNHits();
+	  chmask = 0;
+	  while (__builtin_popcount(chmask) < nhits)
+	    chmask |= (1u << (lgRand() & 0x1f)) & lgChannels;
+
+	  *rol->dabufp++ = geo | C775_HEADER_DATA
+	    | ((c775Cfg.crateID & 0xff) << 16) | (nhits << 8);
+	  for (ii = 0; ii < nhits; ii++)
+	    {
+	      ch = __builtin_ctz(chmask);
+	      chmask &= chmask - 1;
+	      *rol->dabufp++ = geo | C775_DATA | (ch << 16) | 0x4000
+		| (lgRand() & 0xfff);
+	    }
+	  *rol->dabufp++ = geo | C775_TRAILER_DATA
+	    | ((lgEvCount + iev) & C775_EVENTCOUNT_MASK);
+	}
+    }
+  lgEvCount += blklevel;
+}
+
+/* Wait for the block in the TDCs (and left over from the last block).
+   With ackPerEvent, the rest of the block is let in here: the trigger
+   that started usrtrig holds the latch, and it is released only once
+   its event is in every TDC, so that no TDC ever takes an event of the
+   next block.  Either way the last trigger of the block is released by
+   __done.  Returns the events every TDC has, at most blklevel; fewer if
+   the rest of the block does not come within BLOCK_TIMEOUT_NS. */
+static int
+c775WaitBlock()
+{
+  int id, n, ready, nev = 0, acked = 0, seen = -1;
+  unsigned long long t, moved = 0;
+  struct timespec start, pace = { 0, BLOCK_POLL_NS };
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (1)
+    {
+      nev = blklevel;
+      for (id = 0; id < Nc775; id++)
+	{
+	  n = c775CarryEv[id];
+	  if (n < blklevel)
+	    {
+	      ready = c775DreadyMin(id, blklevel - n);
+	      if (ready > 0)
+		n += ready;
+	    }
+	  if (n < nev)
+	    nev = n;
+	}
+      if (nev >= blklevel)
+	break;
+      if (ackPerEvent && (nev > acked))
+	{
+	  s3610IntAck(TRIG_INPUT);
+	  acked = nev;
+	}
+      t = nsSince(&start);
+      if (nev > seen)
+	{
+	  seen = nev;
+	  moved = t;
+	}
+      if (t > BLOCK_TIMEOUT_NS)
+	{
+	  daLogMsg("WARN", "Block of %d events closed with %d", blklevel,
+		   nev);
+	  break;
+	}
+      if ((t - moved) > BLOCK_SPIN_NS)
+	nanosleep(&pace, NULL);
+    }
+
+  return nev;
+}
+
+/* Words of the first nev events of a block (in CPU byte order) */
+static int
+c775EventWords(volatile unsigned int *data, int nev)
+{
+  int ii, nw = 0;
+
+  for (ii = 0; ii < nev; ii++)
+    nw += ((data[nw] & C775_WORDCOUNT_MASK) >> 8) + 2;
+  return nw;
+}
+
+/* Exactly nev events of a TDC into the bank: first those left over
+   from the last block, then from the TDC, keeping what is read beyond
+   the block for the next one.  With zerocopy the TDC writes straight
+   into the bank.  Returns OK, or ERROR if the TDC is short of events. */
+static int
+c775ReadTdc(int id, int zerocopy, int nev)
+{
+  int ii, nevt, need, nw, first, extra;
+  volatile unsigned int *buf;
+
+  need = (c775CarryEv[id] < nev) ? c775CarryEv[id] : nev;
+  nw = c775EventWords(c775Carry[id], need);
+  for (ii = 0; ii < nw; ii++)
+    *rol->dabufp++ = c775Carry[id][ii];
+  c775CarryWords[id] -= nw;
+  c775CarryEv[id] -= need;
+  if (c775CarryWords[id] > 0)
+    memmove(c775Carry[id], &c775Carry[id][nw], c775CarryWords[id] * 4);
+  need = nev - need;
+  if (need == 0)
+    return OK;
+
+  buf = c775Node->data;
+  if (zerocopy)
+    {
+      /* MBLT needs a 64 bit aligned destination: pad with a filler (not
+	 valid datum) word */
+      if ((unsigned long) rol->dabufp & 0x7)
+	*rol->dabufp++ = C775_INVALID_DATA;
+      buf = rol->dabufp;
+    }
+  nevt = c775ReadEvents(id, buf, C775_BUF_WORDS, &c775Index);
+  if (nevt < need)
+    {
+      daLogMsg("ERROR", "TDC %d: %d of %d events", id, nevt, need);
+      return ERROR;
+    }
+
+  /* The block, then the rest for the next block.  The BERR word and
+     anything outside of an event are dropped. */
+  first = c775Index.offset[0];
+  nw = c775Index.offset[need] - first;
+  extra = c775Index.offset[nevt] - c775Index.offset[need];
+  for (ii = 0; ii < extra; ii++)
+    c775Carry[id][ii] = buf[c775Index.offset[need] + ii];
+  c775CarryWords[id] = extra;
+  c775CarryEv[id] = nevt - need;
+  if (zerocopy && (first == 0))
+    rol->dabufp += nw;
+  else
+    for (ii = 0; ii < nw; ii++)
+      *rol->dabufp++ = buf[first + ii];
+
+  return OK;
+}
+
+/* After a read error: forget the left over events and empty the TDCs,
+   so that they start the next block together */
+static void
+c775Resync()
+{
+  int id;
+
+  for (id = 0; id < Nc775; id++)
+    c775CarryEv[id] = c775CarryWords[id] = 0;
+  c775ClearAll();
+}
 static void __download()
 {
     daLogMsg("INFO","Readout list compiled %s", DAYTIME);
@@ -25,6 +416,8 @@ static void __download()
   {  /* begin user */
 {/* inline c-code */
  
+  char *env;
+
   bigendian_out = 1;
   vmeOpenDefaultWindows();
 
@@ -32,6 +425,35 @@ static void __download()
   s3610Init(TRIG_ADDR, 0, 0, DAQ_MODE);
   s3610Status(0, 0);
   GENPollValue = TRIG_INPUT;
+
+  if ((env = getenv("C775_BLOCKLEVEL")) != NULL)
+    blklevel = atoi(env);
+  if ((blklevel < 1) || (blklevel > C775_MAX_EVENTS))
+    {
+      daLogMsg("ERROR", "Block level %d out of range (1-%d)", blklevel,
+	       C775_MAX_EVENTS);
+      blklevel = 1;
+    }
+  ackPerEvent = ((env = getenv("C775_TRIGGER_ACK")) == NULL)
+    || (strcmp(env, "block") != 0);
+  if (!ackPerEvent && (blklevel > 1))
+    daLogMsg("WARN", "Trigger released once per block: the trigger logic"
+	     " must hold off after %d triggers", blklevel);
+
+  /* DMA memory for the TDC block reads */
+  dmaPFreeAll();
+  vmeIN = dmaPCreate("vmeIN", C775_BUF_WORDS * 4, 1, 0);
+  dmaPReInitAll();
+  c775Node = dmaPGetItem(vmeIN);
+
+  /* Find and set up the TDCs */
+  if (c775Discover(C775_ADDR, C775_ADDR_END, C775_ADDR_INC, 0,
+		   C775_MCST_ADDR) <= 0)
+    daLogMsg("ERROR", "No c775 TDCs found");
+  c775SetBlockSwap(1);		/* Bank data in CPU byte order */
+  vmeDmaConfig(1, 3, 0);	/* A24 MBLT */
+
+  lgInit();
 	    
  
  }/*end inline c-code */
@@ -46,8 +468,27 @@ CTRIGINIT;
     *(rol->nevents) = 0;
   {  /* begin user */
 unsigned long jj, adc_id;
+char *cfgfile;
+int id, nwrite;
     daLogMsg("INFO","Entering User Prestart");
 
+    /* Bring the TDCs to the configuration file: only the registers that
+       changed since the last run are written */
+    if ((cfgfile = getenv("C775_CONFIG")) == NULL)
+      cfgfile = C775_CONFIG;
+    if (c775ConfigLoad(cfgfile, &c775Cfg) != OK)
+      {
+	daLogMsg("WARN", "Using the default c775 configuration");
+	c775ConfigDefault(&c775Cfg);
+      }
+    nwrite = c775ConfigApply(&c775Cfg);
+    for (id = 0; id < Nc775; id++)
+      c775EnableBerr(id);
+    c775Resync();
+    daLogMsg("INFO", "%d c775 TDC(s), %d registers written, block level %d,"
+	     " trigger released per %s", Nc775, nwrite, blklevel,
+	     ackPerEvent ? "event" : "block");
+
     GEN_INIT;
     CTRIGRSS(GEN,1,usrtrig,usrtrig_done);
     CRTTYPE(1,GEN,1);
@@ -66,7 +507,16 @@ static void __end()
 {/* inline c-code */
  
 {
+  double dt = nsSince(&runStart) * 1e-9;
+
   s3610Status(0, 0);
+  c775DisableAll();
+  if (Nc775 > 0)
+    c775Status(0);
+  if (dt > 0.0)
+    daLogMsg("INFO", "%llu events in %.1f s: %.0f events/s, %.2f MB/s%s",
+	     runEvents, dt, runEvents / dt, runWords * 4e-6 / dt,
+	     lgOn ? " (load generator)" : "");
 }
  
  }/*end inline c-code */
@@ -92,6 +542,11 @@ static void __go()
     daLogMsg("INFO","Entering User Go");
 
   s3610Status(0, 0);
+  c775EnableAll();
+  runEvents = runWords = 0;
+  lgNext = 0;
+  lgEvCount = 1;
+  clock_gettime(CLOCK_MONOTONIC, &runStart);
   CDOENABLE(GEN,1,1);
   }  /* end user */
     if (__the_event__) WRITE_EVENT_;
@@ -101,23 +556,57 @@ void usrtrig(unsigned long EVTYPE,unsigned long EVSOURCE)
 {
     long EVENT_LENGTH;
   {  /* begin user */
-unsigned long ii, evtnum;
+unsigned long evtnum;
+int id, ok, nev, zerocopy;
+volatile unsigned int *event, *start;
  evtnum = *(rol->nevents);
- CEOPEN(ROCID,BT_BANK,blklevel);
- InsertDummyTriggerBank(trigBankType,evtnum,EVTYPE,blklevel);
- CBOPEN(1,BT_UI4,blklevel);
+ if(lgOn) {
+   lgWaitTrigger();
+   nev = blklevel;
+ } else
+   nev = c775WaitBlock();
+ ok = (nev > 0);
+ event = rol->dabufp;
+ CEOPEN(ROCID,BT_BANK,nev);
+ InsertDummyTriggerBank(trigBankType,evtnum,EVTYPE,nev);
+ CBOPEN(1,BT_UI4,nev);
     CBWRITE32(0xda000011); 
 {/* inline c-code */
  
-   /* This is dummy data */
-   for(ii=0;ii<ndatawords;ii++) {
-     *rol->dabufp++ = ii;
-   }
+   /* The block (short if the TDCs did not get all of it in time) from
+      every TDC, one DMA each.  When the event buffer is DMA memory the
+      TDCs write straight into the bank, and the events are checked
+      there; otherwise they go through vmeIN. */
+   start = rol->dabufp;
+   zerocopy = (vmeDmaLocalToPhysAdrs((unsigned long) rol->dabufp) != 0);
+   if(lgOn)
+     lgWriteBlock();
+   else for(id=0;(id<Nc775) && ok;id++)
+     ok = (c775ReadTdc(id, zerocopy, nev) == OK);
  
  }/*end inline c-code */
     CBWRITE32(0xda0000ff); 
  CBCLOSE;
  CECLOSE;
+{/* inline c-code */
+ 
+   /* No events in time, or a TDC short of the events it counted: the
+      block is replaced by an empty event.  After a read error the TDCs
+      are emptied to line them up again. */
+   if(!ok) {
+     rol->dabufp = (void *) event;
+     CEOPEN(ROCID,BT_BANK,0);
+     CECLOSE;
+     if(nev > 0) {
+       daLogMsg("WARN","Block %lu dropped, TDCs cleared",evtnum);
+       c775Resync();
+     }
+   } else {
+     runEvents += nev;
+     runWords += rol->dabufp - start;
+   }
+ 
+ }/*end inline c-code */
   }  /* end user */
 } /*end trigger */
 
@@ -131,6 +620,9 @@ void __done()
 {
 poolEmpty = 0; /* global Done, Buffers have been freed */
   {  /* begin user */
+  /* The last release of the block (the only one with ackPerEvent off).
+     The TDC read counts need no c775IncrEventBlk: c775ReadEvents took
+     them from the trailers */
   s3610IntAck(TRIG_INPUT);
   }  /* end user */
 } /*end done */